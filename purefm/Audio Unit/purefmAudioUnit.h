@@ -20,6 +20,9 @@ enum {
     kParam_MiddleC,
     kParam_Portamento,
     kParam_Tuning,
+
+    kParam_OpLevel = 0x100,     // + op number - 1
+    kParam_OpRate = 0x108,      // + op number - 1
 };
 
 @interface purefmAudioUnit : AUAudioUnit
@@ -33,9 +36,19 @@ enum {
 @property (readonly) double lfoRate;
 
 - (void)updatePatch;
+
+// running status for the view: taken by the kernel only while enabled,
+// and passed on to the state by updateStatus.
+- (void)setStatusEnabled:(BOOL)enabled;
+- (void)updateStatus;
 - (void)addImport:(Importer *)importer;
 
 - (void)setupAudioBuses;
 - (void)setupParameterTree;
 - (void)setupParameterCallbacks;
+
+// the model showing its own value in the parameter tree. unlike a host or
+// the view setting the parameter, this is not passed on to the kernel as
+// automation: the patch already holds the value.
++ (void)setModelValue:(AUValue)value forParameter:(AUParameter *)parameter;
 @end
@@ -93,7 +93,17 @@
 - (void)updatePatch {
     [_kernelAdapter setPatch:[self.state patch]];
     self.state.parameterTree = _parameterTree;
-    self.state.status = [_kernelAdapter status];
+}
+
+- (void)setStatusEnabled:(BOOL)enabled {
+    [_kernelAdapter setStatusEnabled:enabled];
+}
+
+- (void)updateStatus {
+    struct status status;
+    if ([_kernelAdapter readStatus:&status]) {
+        [self.state updateStatus:&status];
+    }
 }
 
 // MARK: AUAudioUnit Setup
@@ -199,8 +209,37 @@
                                dependentParameters:nil];
 
 
+    NSMutableArray< AUParameter * > *operators = [NSMutableArray array];
+    for (int i = 0; i < 8; ++i) {
+        [operators addObject:
+         [AUParameterTree createParameterWithIdentifier:[NSString stringWithFormat:@"op%dlevel", i+1]
+                                                   name:[NSString stringWithFormat:@"Operator %d Level", i+1]
+                                                address:kParam_OpLevel + i
+                                                    min:0
+                                                    max:127
+                                                   unit:kAudioUnitParameterUnit_Generic
+                                               unitName:nil
+                                                  flags:kAudioUnitParameterFlag_IsReadable|kAudioUnitParameterFlag_IsWritable
+                                           valueStrings:nil
+                                    dependentParameters:nil]];
+    }
+    for (int i = 0; i < 8; ++i) {
+        // not part of the patch: faster (or slower) by, on every stage
+        [operators addObject:
+         [AUParameterTree createParameterWithIdentifier:[NSString stringWithFormat:@"op%drate", i+1]
+                                                   name:[NSString stringWithFormat:@"Operator %d Rate", i+1]
+                                                address:kParam_OpRate + i
+                                                    min:-127
+                                                    max:127
+                                                   unit:kAudioUnitParameterUnit_Generic
+                                               unitName:nil
+                                                  flags:kAudioUnitParameterFlag_IsReadable|kAudioUnitParameterFlag_IsWritable
+                                           valueStrings:nil
+                                    dependentParameters:nil]];
+    }
+
     // Create the parameter tree.
-    _parameterTree = [AUParameterTree createTreeWithChildren:@[
+    _parameterTree = [AUParameterTree createTreeWithChildren:[@[
         feedback,
         lfoWave,
         lfoFrequency,
@@ -208,14 +247,39 @@
         middleC,
         portamento,
         tuning,
-    ]];
+    ] arrayByAddingObjectsFromArray:operators]];
+
+    // the kernel applies these itself at the offset of their render events,
+    // ramps included, rather than waiting for the model to change the patch
+    [_kernelAdapter automateParameter:kParam_Feedback as:param_feedback];
+    [_kernelAdapter automateParameter:kParam_LFOFreq as:param_lfo_frequency];
+    for (int i = 0; i < 8; ++i) {
+        [_kernelAdapter automateParameter:kParam_OpLevel + i as:param_op_level + i];
+        [_kernelAdapter automateParameter:kParam_OpRate + i as:param_op_rate + i];
+    }
+}
+
+// set on the thread where the model is setting a parameter, which is the
+// thread implementorValueObserver is called on
+static thread_local bool modelSetting = false;
+
++ (void)setModelValue:(AUValue)value forParameter:(AUParameter *)parameter {
+    modelSetting = true;
+    [parameter setValue:value];
+    modelSetting = false;
 }
 
 - (void)setupParameterCallbacks {
     __block State * const *state = &_state;
+    purefmDSPKernelAdapter *kernelAdapter = _kernelAdapter;
 
 	// implementorValueObserver is called when a parameter changes value.
 	_parameterTree.implementorValueObserver = ^(AUParameter *param, AUValue value) {
+        if (modelSetting) {
+            // the model already has it, and the patch is not automation
+            return;
+        }
+        [kernelAdapter setParameter:param.address value:value];
         if (*state != nil) {
             [*state setParameter:param value:value];
         }
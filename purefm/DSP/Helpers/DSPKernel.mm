@@ -10,7 +10,8 @@
 
 void DSPKernel::handleOneEvent(AURenderEvent const *event) {
     switch (event->head.eventType) {
-        case AURenderEventParameter: {
+        case AURenderEventParameter:
+        case AURenderEventParameterRamp: {
             handleParameterEvent(event->parameter);
             break;
         }
@@ -25,9 +25,29 @@ NS_ASSUME_NONNULL_BEGIN
 
 #ifdef __cplusplus
 - (void)setPatch:(patch_ptr::pointer const &)patch;
+- (void)setPatch:(patch_ptr::pointer const &)patch forChannel:(int)channel;
 #endif // __cplusplus
 
-- (struct status const *)status;
+// multi timbral: each midi channel plays its own patch from a shared pool
+// of voices. call only while render resources are deallocated. the plug-in
+// itself does not offer it yet; it plays one patch on every channel.
+- (void)setMulti:(BOOL)multi voices:(int)voices;
+
+// a parameter the engine also applies itself (a param_id), at the sample
+// offset of its render events. call before rendering.
+- (void)automateParameter:(AUParameterAddress)address as:(int)param;
+
+// an automated parameter changed outside of render, from any thread.
+- (void)setParameter:(AUParameterAddress)address value:(AUValue)value;
+
+// status is taken once per render block only while enabled.
+// read it back from one non-realtime thread; NO until there is one.
+- (void)setStatusEnabled:(BOOL)enabled;
+- (BOOL)readStatus:(struct status *)status;
+
+// per render block counters, oldest first; NO when none are waiting.
+// call from one non-realtime thread only.
+- (BOOL)nextBlockStats:(struct block_stats *)stats;
 
 - (void)allocateRenderResources;
 - (void)deallocateRenderResources;
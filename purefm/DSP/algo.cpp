@@ -9,28 +9,38 @@
 #include "algo.hpp"
 #include <algorithm>
 
-algo::algo(globals const *g, int const &lfo, int const &pitch, int const &pressure) {
+algo::algo(globals const *g, part const *const &part,
+           int const &lfo, int const &pitch, int const &pressure) :
+    _part(part),
+    _ops{{g, part, lfo, pitch, pressure, _copies, _detune, 0},
+         {g, part, lfo, pitch, pressure, _copies, _detune, 1},
+         {g, part, lfo, pitch, pressure, _copies, _detune, 2},
+         {g, part, lfo, pitch, pressure, _copies, _detune, 3},
+         {g, part, lfo, pitch, pressure, _copies, _detune, 4},
+         {g, part, lfo, pitch, pressure, _copies, _detune, 5},
+         {g, part, lfo, pitch, pressure, _copies, _detune, 6},
+         {g, part, lfo, pitch, pressure, _copies, _detune, 7}} {
     _globals = g;
     _patch = nullptr;
-
-    for (auto &&o : _ops) {
-        o = new op(g, lfo, pitch, pressure);
-    }
+    _reach = 0;
+    _loops = 0;
+    std::fill_n(_sum, 8, -1);
+    std::fill_n(_mod, 8, -1);
+    std::fill_n(_order, 8, -1);
+    _copies = 1;
+    std::fill_n(_detune, max_unison, 0);
+    std::fill_n(_pan, max_unison, 0);
 }
 
 algo::~algo() {
-    for (auto &&o : _ops) {
-        delete o;
-        o = nullptr;
-    }
 }
 
 void
-algo::update(patch const *patch) {
+algo::update(patch const *patch, bool reset) {
     _patch = patch;
     if (patch == nullptr) {
         for (int i = 0; i < 8; ++i) {
-            _ops[i]->update(nullptr, true);
+            _ops[i].update(nullptr, true);
         }
         return;
     }
@@ -38,29 +48,129 @@ algo::update(patch const *patch) {
     for (int i = 0; i < 8; ++i) {
         auto const &op = patch->ops[i];
         set_op_node(i, op->sum, op->mod);
-        _ops[i]->update(op.get(), true);
+        _ops[i].update(op.get(), reset);
+    }
+    compile();
+}
+
+// ops which an op needs this block: an op producing output needs both
+// its summing and modulating inputs, while a pass through op (disabled,
+// silent or idle) only needs what it sums from.
+static inline int
+inputs(int sum, int mod, bool active) {
+    int need = 0;
+    if (sum >= 0) {
+        need |= (1 << sum);
+    }
+    if (active && mod >= 0) {
+        need |= (1 << mod);
     }
+    return need;
+}
+
+// walk the sum/mod graph back from the output (op 0) and keep only the
+// ops which can ever reach it, in the order they step.
+void
+algo::compile() {
+    _reach = 0;
+    for (int pending = 1; pending != 0; ) {
+        int const i = __builtin_ctz(pending);
+        _reach |= (1 << i);
+        pending |= inputs(_sum[i], _mod[i], true);
+        pending &= ~_reach;
+    }
+
+    int n = 0;
+    for (int j = 7; j >= 0; --j) {
+        if ((_reach & (1 << j)) != 0) {
+            _order[n++] = j;
+        }
+    }
+    while (n < 8) {
+        _order[n++] = -1;
+    }
+}
+
+// same walk over the reachable ops, as they are right now: the inputs of
+// ops not producing output (such as modulators of an idle carrier) are
+// skipped for the block (op::skip()).
+int
+algo::schedule() const {
+    int need = 0;
+    for (int pending = 1; pending != 0; ) {
+        int const i = __builtin_ctz(pending);
+        need |= (1 << i);
+        pending |= inputs(_sum[i], _mod[i], _ops[i].active());
+        pending &= ~need;
+    }
+    return need;
 }
 
 void
 algo::set_op_node(int op_num, int sum, int mod) {
     auto &o = _ops[op_num];
+    _sum[op_num] = sum;
+    _mod[op_num] = mod;
 
     if (sum < 0) {
-        o->set_sum(nullptr);
+        o.set_sum(nullptr);
     } else {
-        o->set_sum(_ops[sum]);
+        o.set_sum(&_ops[sum]);
     }
 
     if (mod < 0) {
-        o->set_mod(nullptr);
+        o.set_mod(nullptr);
     } else if (mod <= op_num) {
-        o->set_fb_input(&_fb);
-        _ops[mod]->set_fb_output(&_fb);
+        o.set_fb_input(&_fb[mod]);
     } else {
-        o->set_mod(_ops[mod]);
-        _ops[mod]->set_fb_output(nullptr);
+        o.set_mod(&_ops[mod]);
     }
+    feedback();
+}
+
+// an op feeds its loop while any op modulates from it backwards
+void
+algo::feedback() {
+    _loops = 0;
+    for (int i = 0; i < 8; ++i) {
+        if (_mod[i] >= 0 && _mod[i] <= i) {
+            _loops |= (1 << _mod[i]);
+        }
+    }
+    for (int j = 0; j < 8; ++j) {
+        _ops[j].set_fb_output((_loops & (1 << j)) != 0 ? &_fb[j] : nullptr);
+    }
+}
+
+// ops step from the highest down, so an op's output from the last sample is
+// only read again if an op at or above it sums from it. (modulators are
+// always above, and feedback goes through the filter instead.)
+void
+algo::settle() {
+    for (int j = 0; j < 8; ++j) {
+        bool dead = true;
+        for (int i = j; i < 8; ++i) {
+            if (_sum[i] == j) {
+                dead = false;
+            }
+        }
+        _ops[j].settle(dead);
+    }
+}
+
+// a modulator of an idle carrier still counts: it is skipped, not stopped,
+// and plays on into the next note the voice starts.
+bool
+algo::idle() const {
+    for (int j : _order) {
+        if (j < 0) {
+            break;
+        }
+        if (_ops[j].active()) {
+            return false;
+        }
+    }
+    return true;
 }
 
 void
@@ -70,24 +180,97 @@ algo::start(patch const *patch, int key, int velocity) {
         return;
     }
 
+    if (velocity > 0) {
+        unison(patch);
+    }
     for (int i = 0; i < 8; ++i) {
-        _ops[i]->start(_patch->ops[i].get(), key, velocity);
+        _ops[i].start(_patch->ops[i].get(), key, velocity);
+    }
+}
+
+// copies spread evenly over the detune and pan ranges, lowest pitch on the
+// left. the ops read them for as long as the note plays.
+void
+algo::unison(patch const *patch) {
+    int const n = std::min(std::max(patch->unison, 1), max_unison);
+    _copies = n;
+    for (int k = 0; k < max_unison; ++k) {
+        if (k >= n || n == 1) {
+            _detune[k] = 0;
+            _pan[k] = 0;
+            continue;
+        }
+        int const place = 2 * k - (n - 1); // odd steps either side of centre
+        _detune[k] = (patch->spread * place) / (2 * (n - 1));
+        _pan[k] = (std::min(std::max(patch->width, 0), 128) * place) / (n - 1);
     }
 }
 
 void
-algo::step(int *out) {
+algo::step(int *out, int *side) {
     if (_patch == nullptr) {
         return;
     }
 
+    op *run[8];
+    int n = 0;
+    int const need = schedule();
+    for (int j : _order) {
+        if (j < 0) {
+            break;
+        }
+        if ((need & (1 << j)) != 0) {
+            run[n++] = &_ops[j];
+            if (_ops[j].active()) {
+                _ops[j].group();
+            }
+        } else if (_ops[j].active()) {
+            _ops[j].skip();
+        }
+    }
+
+    // the loops in use, side by side with their amounts
+    fb_filter *loops[8];
+    int amounts[8];
+    int m = 0;
+    for (int bits = _loops; bits != 0; bits &= bits - 1) {
+        int const j = __builtin_ctz(bits);
+        int const amount = _patch->ops[j]->feedback;
+        loops[m] = &_fb[j];
+        amounts[m++] = amount >= 0 ? amount : _part->param(param_feedback, _patch->feedback);
+    }
+
+    // op 0 is always needed, and always last
+    int const copies = _copies;
+    int const *o0 = _ops[0].output();
+    if (copies == 1) {
+        for (int i = 0; i < 16; ++i) {
+            for (int j = 0; j < m; ++j) {
+                loops[j]->step(amounts[j], 1);
+            }
+            for (int j = 0; j < n; ++j) {
+                run[j]->step();
+            }
+            out[i] = o0[0];
+        }
+        std::fill_n(side, 16, 0);
+        return;
+    }
+
     for (int i = 0; i < 16; ++i) {
-        _fb.step(_patch->feedback);
-        int o0 = 0;
-        for (int j = 7; j >= 0; --j) {
-            op *o = _ops[j];
-            o0 = o->step();
+        for (int j = 0; j < m; ++j) {
+            loops[j]->step(amounts[j], copies);
+        }
+        for (int j = 0; j < n; ++j) {
+            run[j]->step();
+        }
+        int mid = 0;
+        int64_t s = 0;
+        for (int k = 0; k < copies; ++k) {
+            mid += o0[k];
+            s += (int64_t)o0[k] * _pan[k];
         }
-        *(out++) = o0;
+        out[i] = mid;
+        side[i] = (int)(s >> 7);
     }
 }
@@ -13,28 +13,75 @@
 #include "env.hpp"
 #include "globals.hpp"
 
+#include <algorithm>
+
 class algo {
     public:
-        algo(globals const *, int const &lfo, int const &pitch, int const &pressure);
-        virtual ~algo();
+        algo(globals const *, part const *const &, int const &lfo, int const &pitch, int const &pressure);
+        ~algo();
 
         // adjust the algorithm as such:
         // op [0,7] sums from sum, or zero if -1, and
         // modulates from mod, or zero if -1, and
-        // if mod <= op, a feedback loop is assumed
+        // if mod <= op, a feedback loop is assumed.
+        // each op fed back has a loop of its own.
         void set_op_node(int op, int sum, int mod);
 
-        void update(patch const *);
+        void update(patch const *, bool reset = true);
 
         void start(patch const *, int key, int velocity);
-        void step(int *output); // output is 16 elements
-        eg_status const *get_eg_status(int i) const { return _ops[i]->get_status(); }
+
+        // output is 16 elements, the sum of the unison copies. side is their
+        // stereo difference from it (right minus left, halved), 0 without unison.
+        void step(int *output, int *side);
+        int copies() const { return _copies; }
+        bool idle() const; // no op producing output
+        eg_status get_eg_status(int i) const { return _ops[i].get_status(); }
+
+        // see op::settle()
+        void settle();
+
+        template<class Archive>
+        void serialize(Archive &a) {
+            a(_copies);
+            _copies = std::min(std::max(_copies, 1), max_unison);
+            a(_detune);
+            a(_pan);
+            for (auto &&f : _fb) {
+                f.serialize(a, _copies);
+            }
+            for (auto &&o : _ops) {
+                o.serialize(a);
+            }
+        }
+
+    private:
+        void compile();
+        void feedback();
+        int schedule() const;
+        void unison(patch const *);
 
     private:
         globals const *_globals;
+        part const *const &_part;
         patch const *_patch;
-        fb_filter _fb;
-        op *_ops[8];
+        fb_filter _fb[8]; // the loop from each op fed back
+        int _loops; // ops fed back, as a mask
+        op _ops[8]; // wired to each other and to _fb by address
+
+        // algorithm as wired by set_op_node(), -1 for none
+        int _sum[8];
+        int _mod[8];
+
+        // ops which can reach the output at all, in step order
+        int _order[8];
+        int _reach;
+
+        // unison copies of the note, and their detune (pitch units) and
+        // pan [-128,128] as of its note on
+        int _copies;
+        int _detune[max_unison];
+        int _pan[max_unison];
 
 };
 
@@ -0,0 +1,240 @@
+//
+//  cache.cpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#include "cache.hpp"
+
+#include <typeinfo>
+
+static uint64_t
+fnv(uint64_t h, void const *data, size_t length) {
+    auto const *p = static_cast<uint8_t const *>(data);
+    for (size_t i = 0; i < length; ++i) {
+        h = (h ^ p[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+template<class T>
+static uint64_t
+fnv(uint64_t h, T const &v) {
+    return fnv(h, &v, sizeof(v));
+}
+
+static uint64_t
+env_hash(uint64_t h, env_patch const *env) {
+    h = fnv(h, env != nullptr);
+    if (env == nullptr) {
+        return h;
+    }
+    h = fnv(h, env->loop);
+    h = fnv(h, env->expr);
+    h = fnv(h, env->after);
+    h = fnv(h, env->lfo);
+    h = fnv(h, env->bend);
+    h = fnv(h, env->scale);
+    h = fnv(h, env->key_up);
+
+    auto const *egs = env->egs.get();
+    h = fnv(h, egs == nullptr ? (size_t)0 : egs->size());
+    if (egs != nullptr) {
+        for (auto const &eg : *egs) {
+            h = fnv(h, eg->type);
+            h = fnv(h, eg->goal);
+            h = fnv(h, eg->rate);
+        }
+    }
+    return h;
+}
+
+uint64_t
+patch_hash(patch const *p) {
+    uint64_t h = 14695981039346656037ULL;
+    if (p == nullptr) {
+        return h;
+    }
+    h = fnv(h, p->feedback);
+    h = fnv(h, p->mono);
+    h = fnv(h, p->middle_c);
+    h = fnv(h, p->portamento);
+    h = fnv(h, p->tuning);
+    h = fnv(h, p->expr1);
+    h = fnv(h, p->expr2);
+    h = fnv(h, p->unison);
+    h = fnv(h, p->spread);
+    h = fnv(h, p->width);
+
+    auto const *keys = p->keys.get();
+    h = fnv(h, keys != nullptr);
+    if (keys != nullptr) {
+        for (int pitch : keys->pitch) {
+            h = fnv(h, pitch);
+        }
+    }
+
+    for (auto const &op : p->ops) {
+        h = fnv(h, op != nullptr);
+        if (op == nullptr) {
+            continue;
+        }
+        h = fnv(h, op->mod);
+        h = fnv(h, op->sum);
+        h = fnv(h, op->enabled);
+        h = fnv(h, op->level);
+        h = fnv(h, op->resync);
+        h = fnv(h, op->velocity);
+        h = fnv(h, op->rate_scale);
+        h = fnv(h, op->breakpoint);
+        h = fnv(h, op->key_scale_left);
+        h = fnv(h, op->key_scale_right);
+        h = fnv(h, op->scale_type_left);
+        h = fnv(h, op->scale_type_right);
+        h = fnv(h, op->frequency);
+        h = fnv(h, op->fixed);
+        h = fnv(h, op->feedback);
+        h = fnv(h, op->wave);
+        h = env_hash(h, op->env.get());
+    }
+    h = env_hash(h, p->pitch_env.get());
+
+    auto const *lfo = p->lfo.get();
+    h = fnv(h, lfo != nullptr);
+    if (lfo != nullptr) {
+        h = fnv(h, lfo->frequency);
+        h = fnv(h, lfo->resync);
+        auto const *wave = lfo->wave.get();
+        h = fnv(h, wave == nullptr ? (size_t)0 : typeid(*wave).hash_code());
+        h = env_hash(h, lfo->env.get());
+    }
+    return h;
+}
+
+note_cache::note_cache(size_t budget) {
+    _budget = budget;
+    _stats = note_cache_stats();
+}
+
+note_cache::~note_cache() {
+}
+
+note_entry *
+note_cache::begin(uint64_t patch, int key, int velocity, note_inputs const &inputs,
+                  std::vector<uint8_t> const &state, bool *recording) {
+    uint64_t h = fnv(14695981039346656037ULL, patch);
+    h = fnv(h, key);
+    h = fnv(h, velocity);
+    h = fnv(h, inputs.mod_wheel);
+    h = fnv(h, inputs.pitch_bend);
+    h = fnv(h, inputs.pressure);
+    h = fnv(h, state.data(), state.size());
+
+    auto const found = _index.find(h);
+    if (found != _index.end()) {
+        auto &e = *found->second;
+        if (!(e.inputs == inputs) || e.checkpoints[0] != state) {
+            return nullptr; // a hash collision: neither play nor replace
+        }
+        _lru.splice(_lru.begin(), _lru, found->second);
+        e.users++;
+        _stats.hits++;
+        *recording = false;
+        return &e;
+    }
+
+    _stats.misses++;
+    _lru.emplace_front();
+    auto &e = _lru.front();
+    e.hash = h;
+    e.inputs = inputs;
+    e.bytes = 0;
+    e.idle = -1;
+    e.users = 1;
+    e.recording = true;
+    if (!reserve(&e, state.size())) {
+        _lru.pop_front();
+        return nullptr;
+    }
+    e.checkpoints.push_back(state);
+    _index[h] = _lru.begin();
+    _stats.entries++;
+    *recording = true;
+    return &e;
+}
+
+// make room for an entry to grow, least recently used first
+bool
+note_cache::reserve(note_entry *e, size_t bytes) {
+    if (e->bytes + bytes > _budget / 4) {
+        return false;
+    }
+    while (_stats.bytes + bytes > _budget) {
+        auto victim = _lru.end();
+        for (auto i = _lru.end(); i != _lru.begin(); ) {
+            if ((--i)->users == 0) {
+                victim = i;
+                break;
+            }
+        }
+        if (victim == _lru.end()) {
+            return false;
+        }
+        _stats.bytes -= victim->bytes;
+        _index.erase(victim->hash);
+        _lru.erase(victim);
+        _stats.evicted++;
+        _stats.entries--;
+    }
+    e->bytes += bytes;
+    _stats.bytes += bytes;
+    return true;
+}
+
+bool
+note_cache::append(note_entry *e, int const *group) {
+    if (!reserve(e, 16 * sizeof(int))) {
+        return false;
+    }
+    e->samples.insert(e->samples.end(), group, group + 16);
+    return true;
+}
+
+bool
+note_cache::checkpoint(note_entry *e, std::vector<uint8_t> const &state) {
+    if (!reserve(e, state.size())) {
+        return false;
+    }
+    e->checkpoints.push_back(state);
+    return true;
+}
+
+void
+note_cache::release(note_entry *e, bool early) {
+    e->users--;
+    if (early) {
+        _stats.diverged++;
+    }
+}
+
+void
+note_cache::finish(note_entry *e) {
+    e->recording = false;
+    e->users--;
+}
+
+void
+note_cache::clear() {
+    for (auto i = _lru.begin(); i != _lru.end(); ) {
+        if (i->users == 0) {
+            _stats.bytes -= i->bytes;
+            _index.erase(i->hash);
+            i = _lru.erase(i);
+            _stats.entries--;
+        } else {
+            ++i;
+        }
+    }
+}
@@ -0,0 +1,105 @@
+//
+//  cache.hpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#ifndef cache_hpp
+#define cache_hpp
+
+#include "globals.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+// content hash of a patch: equal for equal patches however they were built.
+// (consumer side; calls get() on the patch's messages)
+uint64_t patch_hash(patch const *);
+
+// what a note is rendered under besides its patch and its voice's state.
+// a recording stops applying as soon as any of these moves.
+struct note_inputs {
+    int mod_wheel;
+    int pitch_bend;
+    int pressure;
+
+    bool operator==(note_inputs const &o) const {
+        return mod_wheel == o.mod_wheel && pitch_bend == o.pitch_bend && pressure == o.pressure;
+    }
+};
+
+// one recorded note: voice output in groups of 16 samples from the first
+// group after note on, and the voice state every checkpoint_groups groups
+// to pick up live synthesis from anywhere in it.
+struct note_entry {
+    uint64_t hash;
+    note_inputs inputs;
+    std::vector< std::vector<uint8_t> > checkpoints; // [0] is the voice at note on
+    std::vector<int> samples;
+    size_t bytes;
+    int idle;       // groups until the voice went idle, or -1
+    int users;      // voices playing or recording it; never evicted while > 0
+    bool recording;
+
+    int groups() const { return (int)(samples.size() >> 4); }
+};
+
+struct note_cache_stats {
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long diverged;    // playback handed to live synthesis early
+    unsigned long long evicted;
+    size_t bytes;
+    size_t entries;     // notes held, recording or recorded
+};
+
+//
+// pre-rendered voice output for notes which play the same every time.
+// recording allocates, so this is for offline and preview rendering rather
+// than the realtime kernel. one cache per engine thread; it must outlive
+// any engine using it.
+class note_cache {
+    public:
+        // budget in bytes of recorded samples and checkpoints
+        note_cache(size_t budget);
+        virtual ~note_cache();
+
+        static constexpr int checkpoint_groups = 32;
+
+        // the note as recorded, with *recording false, or a new entry to
+        // record it into. state is the voice right after note on.
+        // nullptr if neither is possible.
+        note_entry *begin(uint64_t patch, int key, int velocity, note_inputs const &,
+                          std::vector<uint8_t> const &state, bool *recording);
+
+        // recording: false once the entry can take no more
+        bool append(note_entry *, int const *group);
+        bool checkpoint(note_entry *, std::vector<uint8_t> const &state);
+
+        // done playing an entry, early if cut short of its end
+        void release(note_entry *, bool early = false);
+
+        // done recording an entry
+        void finish(note_entry *);
+
+        void clear();
+        note_cache_stats const &stats() const { return _stats; }
+
+    private:
+        bool reserve(note_entry *, size_t bytes);
+
+    private:
+        typedef std::list<note_entry> lru_list;
+
+        size_t _budget;
+        lru_list _lru; // most recently used first
+        std::unordered_map<uint64_t, lru_list::iterator> _index;
+        note_cache_stats _stats;
+};
+
+#endif /* cache_hpp */
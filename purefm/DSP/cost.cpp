@@ -0,0 +1,210 @@
+//
+//  cost.cpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#include "cost.hpp"
+#include "oscillator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// cycles per voice sample, from timing engine renders of one to eight op
+// patches (-O2, 2.1GHz x86-64) against the same patches with ops disabled,
+// feedback cut or the lfo shared. an op producing output is nearly all of it.
+static double const voice_cycles = 12.0;   // mix, smoothing, control ticks
+static double const op_cycles = 48.0;      // oscillator, envelope, output
+static double const pass_cycles = 6.0;     // an inactive op copying its sum
+static double const loop_cycles = 6.0;     // feedback filter
+static double const lfo_cycles = 2.0;      // per voice lfo, every 16 samples
+static double const noise_cycles = 1.0;    // its random generator on top
+
+double const idle_voice_cycles = 18.0;
+
+// the key notes are taken to play
+static int const middle_key = 60;
+
+static inline int
+clamp(int v, int lo, int hi) {
+    return std::min(std::max(v, lo), hi);
+}
+
+// envelope steps from entering stage first at level until past the last.
+// linear and attack stages are counted as exponential, which they never
+// take longer than.
+static double
+steps(eg_vec const &egs, int first, int level, int level_adj, int rate_adj) {
+    double n = 0.0;
+    for (size_t i = (size_t)first; i < egs.size(); ++i) {
+        auto const &eg = *egs[i];
+        int const goal = clamp(eg.goal + level_adj, eg_min, eg_max);
+        int const rate = tables::duration_param(clamp(eg.rate - rate_adj, 0, 0x7f));
+        if (eg.type == eg_delay) {
+            n += ((double)eg_max - eg_min) / rate;
+        } else {
+            n += std::abs((double)goal - level) / rate;
+        }
+        level = goal;
+    }
+    return n;
+}
+
+// the level op::start() gives its envelope, unscaled by key or velocity
+static int
+op_level(op_patch const &op) {
+    return eg_min + clamp(op.level, eg_min, eg_max);
+}
+
+// the op's envelope ever runs, and produces something when it does
+static bool
+plays(op_patch const &op) {
+    env_patch const *env = op.env.get();
+    if (!op.enabled || env == nullptr || env->key_up == 0) {
+        // a key up at stage 0 never starts
+        return false;
+    }
+    auto const *egs = env->egs.get();
+    if (egs == nullptr || egs->empty()) {
+        return false;
+    }
+    // see op::start()
+    return !(op.level <= eg_min && env->lfo == 0 && env->after >= 7 && env->expr >= 7);
+}
+
+// seconds a playing op keeps sounding after key up, or -1 if it never stops
+static double
+release(op_patch const &op, double tick) {
+    env_patch const *env = op.env.get();
+    auto const &egs = *env->egs.get();
+    int const level_adj = op_level(op);
+    int const rate_adj = clamp(((middle_key - 21) * op.rate_scale) / 192, 0, 64);
+
+    // envelopes rest at their last goal: an op is only idle there at eg_min
+    if (clamp(egs.back()->goal + level_adj, eg_min, eg_max) != eg_min) {
+        return -1.0;
+    }
+
+    // from the key up stage, from where the stage before held it, or
+    // without one at most the whole envelope once more
+    int const key_up = env->key_up;
+    if (key_up > 0 && key_up < (int)egs.size()) {
+        int const held = clamp(egs[key_up - 1]->goal + level_adj, eg_min, eg_max);
+        return steps(egs, key_up, held, level_adj, rate_adj) * tick;
+    }
+    return steps(egs, 0, eg_min, level_adj, rate_adj) * tick;
+}
+
+patch_cost
+estimate_cost(patch const *patch, double sampleRate, int poly) {
+    patch_cost c;
+    c.ops = 0;
+    c.passes = 0;
+    c.loops = 0;
+    c.copies = 1;
+    c.lfo = false;
+    c.cycles = 0.0;
+    c.release = 0.0;
+    c.endless = false;
+    c.voices = 0;
+    if (patch == nullptr) {
+        return c;
+    }
+
+    bool play[8];
+    for (int i = 0; i < 8; ++i) {
+        play[i] = plays(*patch->ops[i]);
+    }
+
+    // the ops a sounding voice renders, as algo::schedule() walks them, and
+    // those which can reach the output at all, as algo::compile() does
+    int need = 0;
+    for (int pending = 1; pending != 0; ) {
+        int const i = __builtin_ctz(pending);
+        auto const &op = *patch->ops[i];
+        need |= (1 << i);
+        if (op.sum >= 0) {
+            pending |= (1 << op.sum);
+        }
+        if (play[i] && op.mod >= 0) {
+            pending |= (1 << op.mod);
+        }
+        pending &= ~need;
+    }
+    int reach = 0;
+    for (int pending = 1; pending != 0; ) {
+        int const i = __builtin_ctz(pending);
+        auto const &op = *patch->ops[i];
+        reach |= (1 << i);
+        if (op.sum >= 0) {
+            pending |= (1 << op.sum);
+        }
+        if (op.mod >= 0) {
+            pending |= (1 << op.mod);
+        }
+        pending &= ~reach;
+    }
+
+    // envelopes step once per sample of the eg rate divider
+    double const tick = (double)(eg_rate_mask(sampleRate) + 1) / sampleRate;
+
+    int loops = 0;
+    for (int i = 0; i < 8; ++i) {
+        if ((reach & (1 << i)) == 0) {
+            continue;
+        }
+        auto const &op = *patch->ops[i];
+        if ((need & (1 << i)) != 0) {
+            if (!play[i]) {
+                c.passes++;
+                continue;
+            }
+            c.ops++;
+            if (op.mod >= 0 && op.mod <= i) {
+                loops |= (1 << op.mod);
+            }
+        } else if (!play[i]) {
+            continue;
+        }
+        // a voice is idle once every reachable op is (algo::idle()), those
+        // only skipped while their carrier rests included
+        double const r = release(op, tick);
+        if (r < 0.0) {
+            c.endless = true;
+        } else {
+            c.release = std::max(c.release, r);
+        }
+    }
+    c.loops = __builtin_popcount(loops);
+
+    // unison copies share the envelopes, which are a small part of an op
+    c.copies = std::min(std::max(patch->unison, 1), max_unison);
+    c.cycles = voice_cycles + c.copies * (c.ops * op_cycles + c.passes * pass_cycles +
+        c.loops * loop_cycles);
+
+    // a shared lfo is stepped once by the engine for every voice
+    auto const *lfo = patch->lfo.get();
+    if (lfo != nullptr && lfo->resync && lfo->wave.get() != nullptr) {
+        c.lfo = true;
+        c.cycles += lfo_cycles;
+        if (dynamic_cast<noise const *>(lfo->wave.get()) != nullptr) {
+            c.cycles += noise_cycles;
+        }
+    }
+
+    c.voices = patch->mono ? 1 : std::max(poly, 16);
+    return c;
+}
+
+double
+estimate_load(patch_cost const &c, double notes, double held,
+              double sampleRate, int poly) {
+    poly = std::max(poly, 16);
+    double sounding = 0.0;
+    if (notes > 0.0) {
+        sounding = c.endless ? c.voices : std::min((double)c.voices, notes * (held + c.release));
+    }
+    return (sounding * c.cycles + (poly - sounding) * idle_voice_cycles) * sampleRate;
+}
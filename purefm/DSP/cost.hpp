@@ -0,0 +1,44 @@
+//
+//  cost.hpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#ifndef cost_hpp
+#define cost_hpp
+
+#include "globals.hpp"
+
+// what a patch costs to play, from the patch alone, without rendering it:
+// for budgeting parts and instances across hosts before a patch is loaded.
+// notes are taken as played at middle C, velocity 100, with no pedal.
+
+struct patch_cost {
+    int ops;            // ops producing output of their own
+    int passes;         // ops only passing their sum through
+    int loops;          // feedback loops
+    int copies;         // unison copies each op and loop steps
+    bool lfo;           // each voice steps its own lfo
+    double cycles;      // per sounding voice per sample
+    double release;     // seconds a voice keeps sounding after key up
+    bool endless;       // some op never falls silent: voices sound until stolen
+    int voices;         // most voices the part sounds at once
+};
+
+// cycles per sample of a voice holding no note. the engine steps every voice
+// in the pool, sounding or not.
+extern double const idle_voice_cycles;
+
+// poly is the engine's voice pool (engine::allocate())
+patch_cost estimate_cost(patch const *, double sampleRate, int poly = 16);
+
+// cycles per second of one part playing that many notes per second, each held
+// for that many seconds, over a pool of poly voices: the voices sounding at
+// once are the notes started over a voice's lifetime, up to the most it can
+// sound, and the rest of the pool idles.
+double estimate_load(patch_cost const &, double notes, double held,
+                     double sampleRate, int poly = 16);
+
+#endif /* cost_hpp */
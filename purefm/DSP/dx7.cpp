@@ -0,0 +1,540 @@
+//
+//  dx7.cpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#include "dx7.hpp"
+#include "oscillator.hpp"
+#include "tables.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+// sysex layouts, as in YamahaImporter.m
+
+enum {
+    kDX7_Voice = 0,
+    kDX7_32Voices = 9,
+};
+
+typedef struct dx7_voice_op {
+    uint8_t eg_rate[4];
+    uint8_t eg_level[4];
+    uint8_t breakpoint;
+    uint8_t left;
+    uint8_t right;
+    uint8_t left_curve;
+    uint8_t right_curve;
+    uint8_t rate_scale;
+    uint8_t amp_mod;
+    uint8_t velocity;
+    uint8_t level;
+    uint8_t osc_mode;
+    uint8_t freq_coarse;
+    uint8_t freq_fine;
+    uint8_t detune;
+} __attribute((packed)) dx7_voice_op;
+static_assert(sizeof(dx7_voice_op) == 21, "");
+
+typedef struct dx7_sysex_voice {
+    dx7_voice_op ops[6];
+    uint8_t pitch_eg_rate[4];
+    uint8_t pitch_eg_level[4];
+    uint8_t alg;
+    uint8_t feedback;
+    uint8_t osc_sync;
+    uint8_t lfo_speed;
+    uint8_t lfo_delay;
+    uint8_t lfo_pmd;
+    uint8_t lfo_amd;
+    uint8_t lfo_sync;
+    uint8_t lfo_wave;
+    uint8_t pmd;
+    uint8_t transpose;
+    char name[10];
+} __attribute((packed)) dx7_sysex_voice;
+static_assert(sizeof(dx7_sysex_voice) == 155, "");
+
+typedef struct dx7_packed_voice_op {
+    uint8_t eg_rate[4];
+    uint8_t eg_level[4];
+    uint8_t breakpoint;
+    uint8_t left;
+    uint8_t right;
+    uint8_t curves;
+    uint8_t detune_rate_scale;
+    uint8_t velocity_amp_mod;
+    uint8_t level;
+    uint8_t freq_coarse_mode;
+    uint8_t freq_fine;
+} __attribute__((packed)) dx7_packed_voice_op;
+static_assert(sizeof(dx7_packed_voice_op) == 17, "");
+
+typedef struct dx7_packed_voice {
+    dx7_packed_voice_op ops[6];
+    uint8_t pitch_eg_rate[4];
+    uint8_t pitch_eg_level[4];
+    uint8_t alg;
+    uint8_t osc_sync_feedback;
+    uint8_t lfo_speed;
+    uint8_t lfo_delay;
+    uint8_t lfo_pmd;
+    uint8_t lfo_amd;
+    uint8_t lfo_pmd_wave_sync;
+    uint8_t transpose;
+    char name[10];
+} __attribute__((packed)) dx7_packed_voice;
+static_assert(sizeof(dx7_packed_voice) == 128, "");
+
+static size_t const header_size = 6;   // status, id, sub status, format, count
+static size_t const voice_size = sizeof(dx7_sysex_voice);
+static size_t const bank_size = 32 * sizeof(dx7_packed_voice);
+
+typedef struct op_alg {
+    int mod, sum;
+} op_alg;
+
+// see YamahaImporter.m for the operator diagrams
+static op_alg const dx7_alg[32][6] = {
+    { { 1, 2 }, { -1, -1 }, { 3, -1}, { 4, -1}, { 5, -1}, { 5, 6 } },
+    { { 1, 2 }, { 1, -1 }, { 3, -1}, { 4, -1 }, { 5, -1}, { -1, 6 } },
+    { { 1, 3 }, { 2, -1 }, { -1, -1 }, { 4, -1 }, { 5, -1 }, { 5, 6 } },
+    { { 1, 3 }, { 2, -1 }, { -1, -1 }, { 4, -1 }, { 5, -1 }, { 3, 6 } },
+    { { 1, 2 }, { -1, -1 }, { 3, 4 }, { -1, -1 }, { 5, -1 }, { 5, 6 } },
+    { { 1, 2 }, { -1, -1 }, { 3, 4 }, { -1, -1 }, { 5, -1 }, { 4, 6 } },
+    { { 1, 2 }, { -1, -1 }, { 3, -1 }, { -1, 4 }, { 5, -1 }, { 5, 6 } },
+    { { 1, 2 }, { -1, -1 }, { 3, -1 }, { 3, 4 }, { 5, -1 }, { -1, 6 } },
+    { { 1, 2 }, { 1, -1 }, { 3, -1 }, { -1, 4 }, { 5, -1 }, { -1, 6 } },
+    { { 1, 3 }, { 2, -1 }, { 2, -1 }, { 4, -1 }, { -1, 5 }, { -1, 6 } },
+    { { 1, 3 }, { 2, -1 }, { -1, -1 }, { 4, -1 }, { -1, 5 }, { 5, 6 } },
+    { { 1, 2 }, { 1, -1 }, { 3, -1 }, { -1, 4 }, { -1, 5 }, { -1, 6 } },
+    { { 1, 2 }, { -1, -1 }, { 3, -1 }, { -1, 4 }, { -1, 5 }, { 5, 6 } },
+    { { 1, 2 }, { -1, -1 }, { 3, -1 }, { 4, -1 }, { -1, 5 }, { 5, 6 } },
+    { { 1, 2 }, { 1, -1 }, { 3, -1 }, { 4, -1 }, { -1, 5 }, { -1, 6 } },
+    { { 1, -1 }, { -1, 2 }, { 3, 4 }, { -1, -1 }, { 5, -1 }, { 5, 6 } },
+    { { 1, -1 }, { 1, 2 }, { 3, 4 }, { -1, -1 }, { 5, -1 }, { -1, 6 } },
+    { { 1, -1 }, { -1, 2 }, { 2, 3 }, { 4, -1 }, { 5, -1 }, { -1, 6 } },
+    { { 1, 3 }, { 2, -1 }, { -1, -1 }, { 5, 4 }, { 5, -1 }, { 5, 6 } },
+    { { 2, 1 }, { 2, 3 }, { 2, -1 }, { 4, -1 }, { -1, 5 }, { -1, 6 } },
+    { { 2, 1 }, { 2, 3 }, { 2, -1 }, { 5, 4 }, { 5, -1 }, { -1, 6 } },
+    { { 1, 2 }, { -1, -1 }, { 5, 3 }, { 5, 4 }, { 5, -1 }, { 5, 6 } },
+    { { -1, 1 }, { 2, 3 }, { -1, -1 }, { 5, 4 }, { 5, -1 }, { 5, 6 } },
+    { { -1, 1 }, { -1, 2 }, { 5, 3 }, { 5, 4 }, { 5, -1 }, { 5, 6 } },
+    { { -1, 1 }, { -1, 2 }, { -1, 3 }, { 5, 4 }, { 5, -1 }, { 5, 6 } },
+    { { -1, 1 }, { 2, 3 }, { -1, -1 }, { 4, -1 }, { -1, 5 }, { 5, 6 } },
+    { { -1, 1 }, { 2, 3 }, { 2, -1 }, { 4, -1 }, { -1, 5 }, { -1, 6 } },
+    { { 1, 2 }, { -1, -1 }, { 3, 5 }, { 4, -1 }, { 4, -1 }, { -1, 6 } },
+    { { -1, 1 }, { -1, 2 }, { 3, 4 }, { -1, -1 }, { 5, -1 }, { 5, 6 } },
+    { { -1, 1 }, { -1, 2 }, { 3, 5 }, { 4, -1 }, { 4, -1 }, { -1, 6 } },
+    { { -1, 1 }, { -1, 2 }, { -1, 3 }, { -1, 4 }, { 5, -1 }, { 5, 6 } },
+    { { -1, 1 }, { -1, 2 }, { -1, 3 }, { -1, 4 }, { -1, 5 }, { 5, 6 } },
+};
+
+static double const pmd_table[8] = {
+    0.0, 0.5, 1.0, 2.0, 3.0, 4.0, 7.0, 12.0
+};
+
+static double const lfo_table[100] = {
+    0.0625, 0.1248, 0.3115, 0.4354, 0.6198,
+    0.7444, 0.9305, 1.1164, 1.2842, 1.4969,
+    1.5678, 1.7390, 1.9102, 2.0813, 2.2525,
+    2.4237, 2.5807, 2.7377, 2.8947, 3.0517,
+    3.2087, 3.3668, 3.5249, 3.6830, 3.8411,
+    3.9991, 4.1594, 4.3197, 4.4800, 4.6403,
+    4.8005, 4.9536, 5.1066, 5.2597, 5.4127,
+    5.5658, 5.7249, 5.8841, 6.0432, 6.2024,
+    6.3616, 6.5200, 6.6785, 6.8370, 6.9955,
+    7.1540, 7.3005, 7.4470, 7.5935, 7.7399,
+    7.8864, 8.0206, 8.1548, 8.2889, 8.4231,
+    8.5573, 8.7126, 8.8680, 9.0234, 9.1787,
+    9.3341, 9.6696,10.0052, 10.3408, 10.6763,
+    11.0119, 11.9637, 12.9155, 13.8672, 14.8190,
+    15.7708, 16.6402, 17.5097, 18.3791, 19.2486,
+    20.1180, 21.0407, 21.9634, 22.8861, 23.8088,
+    24.7315, 25.7597, 26.7880, 27.8162, 28.8445,
+    29.8727, 31.2282, 32.5837, 33.9392, 35.2947,
+    36.6502, 37.8125, 38.9748, 40.1370, 41.2993,
+    42.4616, 43.6398, 44.8180, 45.9962, 47.1744
+};
+
+// MARK: parameter translation
+
+static int
+dx7_level(int level) {
+    static int const lut[20] =
+        {0, 5, 9, 13, 17, 20, 23, 25, 27, 29, 31, 33, 35, 37, 39, 41, 42, 43, 45, 46};
+    if (level < 20) {
+        return lut[level];
+    }
+    return std::min(level, 99) + 28;
+}
+
+static int
+dx7_scale(int value) {
+    return (int)std::round(((double)std::min(value, 99) / 99.0) * 127.0);
+}
+
+static int
+dx7_duration(int value) {
+    return dx7_scale(value) ^ 127;
+}
+
+static int
+dx7_curve(int value) {
+    static int const curves[4] = {
+        0x00, // linear down
+        0x02, // exp down
+        0x03, // exp up
+        0x01, // linear up
+    };
+    return curves[value & 3];
+}
+
+static eg_ptr
+dx7_stage(eg_type type, int goal, int rate) {
+    auto e = std::make_shared<eg>();
+    e->type = type;
+    e->goal = goal;
+    e->rate = rate;
+    return e;
+}
+
+// expr is in model terms (0-7); the engine shifts by 7 - expr
+static env_patch_ptr::pointer
+dx7_env(std::shared_ptr<eg_vec> const &egs, int key_up, int expr, int lfo) {
+    auto e = std::make_shared<env_patch>();
+    e->loop = false;
+    e->expr = 7 - expr;
+    e->after = 7;
+    e->lfo = lfo;
+    e->bend = 7;
+    e->scale = 7;
+    e->key_up = key_up;
+    e->egs.set(egs);
+    return e;
+}
+
+// an unused op, as the model initializes them
+static op_ptr
+dx7_unused_op(int sum) {
+    auto egs = std::make_shared<eg_vec>();
+    egs->push_back(dx7_stage(eg_attack, tables::level_param(127), 0));
+    egs->push_back(dx7_stage(eg_exp, tables::level_param(0), 0));
+
+    auto o = std::make_shared<op_patch>();
+    o->sum = sum;
+    o->mod = -1;
+    o->enabled = false;
+    o->level = tables::level_param(0);
+    o->resync = false;
+    o->velocity = 0;
+    o->rate_scale = 0;
+    o->breakpoint = 60;
+    o->key_scale_left = 0;
+    o->key_scale_right = 0;
+    o->scale_type_left = 0;
+    o->scale_type_right = 0;
+    o->frequency = 0;
+    o->fixed = false;
+    o->feedback = -1;
+    o->wave = op_wave_sine;
+    o->env.set(dx7_env(egs, 1, 0, 0));
+    return o;
+}
+
+static op_ptr
+dx7_op(dx7_sysex_voice const *voice, int o) {
+    dx7_voice_op const *dx7_op = &voice->ops[5-o];
+
+    // amplitude modulation sensitivity scales both the mod wheel (expr)
+    // and how much of the lfo amplitude depth reaches this operator.
+    int const ams = dx7_op->amp_mod & 3;
+
+    auto egs = std::make_shared<eg_vec>();
+    for (int i = 0; i < 4; ++i) {
+        egs->push_back(dx7_stage(eg_attack,
+                                 tables::level_param(dx7_level(dx7_op->eg_level[i])),
+                                 dx7_duration(dx7_op->eg_rate[i])));
+    }
+
+    op_alg const *alg = &dx7_alg[voice->alg & 31][o];
+    auto p = std::make_shared<op_patch>();
+    p->mod = alg->mod;
+    p->sum = alg->sum;
+    p->enabled = true;
+    p->level = tables::level_param(dx7_level(dx7_op->level));
+    p->resync = voice->osc_sync != 0;
+    p->velocity = dx7_op->velocity & 7;
+    p->rate_scale = (dx7_op->rate_scale & 7) * 127 / 7;
+    p->breakpoint = (int)(dx7_op->breakpoint) + 0x15;
+    p->key_scale_left = dx7_scale(dx7_op->left);
+    p->key_scale_right = dx7_scale(dx7_op->right);
+    p->scale_type_left = dx7_curve(dx7_op->left_curve);
+    p->scale_type_right = dx7_curve(dx7_op->right_curve);
+
+    double v;
+    if (dx7_op->osc_mode != 0) {
+        p->fixed = true;
+        v = std::pow(10.0, (double)(dx7_op->freq_coarse & 3) + (double)(dx7_op->freq_fine) / 100.0);
+        v /= tables::middleC;
+    } else {
+        p->fixed = false;
+        v = (double)(dx7_op->freq_coarse & 31);
+        if (v == 0.0) {
+            v = 0.5;
+        }
+        v *= 1.0 + ((double)(dx7_op->freq_fine) / 100.0);
+    }
+    v = 4096.0 * std::log2(v);
+    p->frequency = (int)std::round(v) + ((dx7_op->detune & 15) - 7) * 4;
+    p->feedback = -1;
+    p->wave = op_wave_sine;
+
+    p->env.set(dx7_env(egs, 3, ams * 7 / 3, dx7_scale(voice->lfo_amd) * ams / 3));
+    return p;
+}
+
+static lfo_patch_ptr::pointer
+dx7_lfo(dx7_sysex_voice const *voice) {
+    auto l = std::make_shared<lfo_patch>();
+
+    double v = lfo_table[std::min((int)voice->lfo_speed, 99)] / (tables::middleC * 16.0);
+    l->frequency = (int)std::round(4096.0 * std::log2(v));
+    l->resync = voice->lfo_sync != 0;
+
+    function_ptr::pointer f;
+    switch (voice->lfo_wave) {
+    case 0:
+        f = std::make_shared<triangle>();
+        break;
+    case 1:
+        f = std::make_shared<sawdown>();
+        break;
+    case 2:
+        f = std::make_shared<sawup>();
+        break;
+    case 3:
+        f = std::make_shared<square>();
+        break;
+    case 5:
+        f = std::make_shared<noise>(); // sample and hold
+        break;
+    default:
+        f = std::make_shared<sine>();
+        break;
+    }
+    l->wave.set(f);
+
+    // delay from note on, then full depth
+    auto egs = std::make_shared<eg_vec>();
+    egs->push_back(dx7_stage(eg_delay, tables::level_param(0), dx7_duration(voice->lfo_delay)));
+    egs->push_back(dx7_stage(eg_delay, tables::level_param(127), 0));
+    l->env.set(dx7_env(egs, -1, 0, 0));
+
+    return l;
+}
+
+static patch_ptr::pointer
+dx7_patch(dx7_sysex_voice const *voice) {
+    auto p = std::make_shared<patch>();
+
+    p->feedback = (1 << (voice->feedback & 7)) - 1;
+    p->mono = false;
+    p->middle_c = (48 - (int)voice->transpose) + 36;
+    p->portamento = tables::duration_param(0);
+    p->tuning = 0;
+    p->expr1 = 1;  // modulation wheel
+    p->expr2 = 11; // expression control
+    p->unison = 1;
+    p->spread = 0;
+    p->width = 0;
+
+    for (int o = 0; o < 6; ++o) {
+        p->ops[o] = dx7_op(voice, o);
+    }
+    p->ops[6] = dx7_unused_op(7);
+    p->ops[7] = dx7_unused_op(-1);
+
+    auto egs = std::make_shared<eg_vec>();
+    for (int i = 0; i < 4; ++i) {
+        egs->push_back(dx7_stage(eg_pitch,
+                                 tables::level_param(dx7_scale(voice->pitch_eg_level[i])),
+                                 dx7_duration(voice->pitch_eg_rate[i])));
+    }
+    auto pitch_env = dx7_env(egs, 3, 0,
+        (int)std::round((pmd_table[voice->pmd & 7] * (double)dx7_scale(voice->lfo_pmd)) / 12.0));
+    pitch_env->scale = 7 - 6;
+    p->pitch_env.set(pitch_env);
+
+    p->lfo.set(dx7_lfo(voice));
+    return p;
+}
+
+static dx7_voice
+dx7_decode(dx7_sysex_voice const *voice) {
+    char name[11];
+    std::memcpy(name, voice->name, 10);
+    name[10] = 0;
+    return dx7_voice{ name, dx7_patch(voice) };
+}
+
+static void
+dx7_unpack(dx7_packed_voice const *p, dx7_sysex_voice *voice) {
+    for (int o = 0; o < 6; ++o) {
+        dx7_packed_voice_op const *pop = &p->ops[o];
+        dx7_voice_op *op = &voice->ops[o];
+
+        std::memcpy(op->eg_rate, pop->eg_rate, sizeof(pop->eg_rate));
+        std::memcpy(op->eg_level, pop->eg_level, sizeof(pop->eg_level));
+        op->breakpoint = pop->breakpoint;
+        op->left = pop->left;
+        op->right = pop->right;
+        op->left_curve = (pop->curves >> 2) & 3;
+        op->right_curve = pop->curves & 3;
+        op->detune = pop->detune_rate_scale >> 3;
+        op->rate_scale = pop->detune_rate_scale & 7;
+        op->velocity = pop->velocity_amp_mod >> 2;
+        op->amp_mod = pop->velocity_amp_mod & 3;
+        op->level = pop->level;
+        op->freq_coarse = pop->freq_coarse_mode >> 1;
+        op->osc_mode = pop->freq_coarse_mode & 1;
+        op->freq_fine = pop->freq_fine;
+    }
+
+    std::memcpy(voice->pitch_eg_rate, p->pitch_eg_rate, 4);
+    std::memcpy(voice->pitch_eg_level, p->pitch_eg_level, 4);
+    voice->alg = p->alg;
+    voice->osc_sync = p->osc_sync_feedback >> 3;
+    voice->feedback = p->osc_sync_feedback & 7;
+    voice->lfo_speed = p->lfo_speed;
+    voice->lfo_delay = p->lfo_delay;
+    voice->lfo_pmd = p->lfo_pmd;
+    voice->lfo_amd = p->lfo_amd;
+    voice->pmd = p->lfo_pmd_wave_sync >> 4;
+    voice->lfo_wave = (p->lfo_pmd_wave_sync >> 1) & 7;
+    voice->lfo_sync = p->lfo_pmd_wave_sync & 1;
+    voice->transpose = p->transpose;
+    std::memcpy(voice->name, p->name, 10);
+}
+
+// MARK: sysex
+
+// the data bytes and their checksum sum to 0 in 7 bits
+static bool
+dx7_valid(uint8_t const *data, size_t count) {
+    unsigned sum = 0;
+    for (size_t i = 0; i <= count; ++i) {
+        sum += data[i];
+    }
+    return (sum & 0x7f) == 0;
+}
+
+dx7_result
+dx7_load(uint8_t const *data, size_t length, std::vector<dx7_voice> *voices) {
+    if (length < header_size || data[0] != 0xf0 || data[1] != 0x43) {
+        return dx7_unknown; // not yamaha
+    }
+
+    uint8_t const format = data[3];
+    size_t const count = ((size_t)data[4] << 7) | data[5];
+    uint8_t const *body = data + header_size;
+
+    switch (format) {
+    case kDX7_Voice: // 1 voice
+        if (count != voice_size) {
+            return dx7_unknown;
+        }
+        break;
+
+    case kDX7_32Voices: // 32 voices packed
+        if (count != bank_size) {
+            return dx7_unknown;
+        }
+        break;
+
+    default:
+        return dx7_unknown; // we only recognize the above forms
+    }
+
+    // data, checksum, end of exclusive
+    if (length < header_size + count + 2 || body[count + 1] != 0xf7) {
+        return dx7_length;
+    }
+    if (!dx7_valid(body, count)) {
+        return dx7_checksum;
+    }
+
+    dx7_sysex_voice voice;
+    if (format == kDX7_Voice) {
+        std::memcpy(&voice, body, voice_size);
+        voices->push_back(dx7_decode(&voice));
+    } else {
+        voices->reserve(voices->size() + 32);
+        for (int n = 0; n < 32; ++n) {
+            dx7_packed_voice packed;
+            std::memcpy(&packed, body + n * sizeof(packed), sizeof(packed));
+            dx7_unpack(&packed, &voice);
+            voices->push_back(dx7_decode(&voice));
+        }
+    }
+    return dx7_ok;
+}
+
+dx7_result
+dx7_load_file(char const *path, std::vector<dx7_voice> *voices) {
+    FILE *f = std::fopen(path, "rb");
+    if (f == nullptr) {
+        return dx7_io;
+    }
+
+    // the largest dump we know of is a 32 voice bank
+    uint8_t data[header_size + bank_size + 2];
+    size_t length = std::fread(data, 1, sizeof(data), f);
+    bool const error = std::ferror(f) != 0;
+    std::fclose(f);
+
+    if (error) {
+        return dx7_io;
+    }
+    return dx7_load(data, length, voices);
+}
+
+// MARK: batch
+
+std::vector<dx7_bank>
+dx7_load_files(std::vector<std::string> const &paths, int threads) {
+    std::vector<dx7_bank> banks(paths.size());
+    std::atomic<size_t> next(0);
+
+    auto work = [&]() {
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            auto &bank = banks[i];
+            bank.path = paths[i];
+            bank.result = dx7_load_file(paths[i].c_str(), &bank.voices);
+        }
+    };
+
+    if (threads <= 0) {
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, (int)std::max(paths.size(), (size_t)1));
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) {
+        pool.emplace_back(work);
+    }
+    work();
+    for (auto &&t : pool) {
+        t.join();
+    }
+
+    return banks;
+}
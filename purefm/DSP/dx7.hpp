@@ -0,0 +1,49 @@
+//
+//  dx7.hpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#ifndef dx7_hpp
+#define dx7_hpp
+
+#include "globals.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// DX7 single voice and 32 voice bulk dump sysex decoding directly into
+// engine patches, without going through the model.
+
+typedef enum {
+    dx7_ok = 0,
+    dx7_unknown,    // not a DX7 voice dump we recognize
+    dx7_length,     // truncated or wrong byte count
+    dx7_checksum,   // data does not match its checksum
+    dx7_io          // file could not be read
+} dx7_result;
+
+struct dx7_voice {
+    std::string name;
+    patch_ptr::pointer patch;
+};
+
+// decode one sysex message, appending its voices
+dx7_result dx7_load(uint8_t const *data, size_t length, std::vector<dx7_voice> *voices);
+dx7_result dx7_load_file(char const *path, std::vector<dx7_voice> *voices);
+
+struct dx7_bank {
+    std::string path;
+    dx7_result result;
+    std::vector<dx7_voice> voices;
+};
+
+// decode many .syx files across threads (0 for one per core).
+// results are in the same order as paths.
+std::vector<dx7_bank> dx7_load_files(std::vector<std::string> const &paths, int threads = 0);
+
+#endif /* dx7_hpp */
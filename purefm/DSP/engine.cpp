@@ -7,55 +7,249 @@
 //
 
 #include "engine.hpp"
+#include "trace.hpp"
 
 #include <algorithm>
+#include <new>
 
-engine::engine(globals *g) {
+// the whole voice bank in one cache aligned block
+static voice *
+new_bank(globals const *g, int poly) {
+    void *mem = ::operator new(sizeof(voice) * poly, std::align_val_t(alignof(voice)));
+    voice *bank = static_cast<voice *>(mem);
+    for (int i = 0; i < poly; ++i) {
+        new (&bank[i]) voice(g);
+    }
+    return bank;
+}
+
+static void
+delete_bank(voice *bank, int poly) {
+    for (int i = 0; i < poly; ++i) {
+        bank[i].~voice();
+    }
+    ::operator delete(bank, std::align_val_t(alignof(voice)));
+}
+
+engine::engine(globals *g, int poly) {
     _globals = g;
-    _now = 0ULL;
-    for (auto &&v : _voices) {
-        v = new voice(g);
+    _bank = nullptr;
+    _voices = nullptr;
+    _poly = poly;
+    _cache = nullptr;
+    for (int p = 0; p < max_parts; ++p) {
+        auto &part = _globals->parts[p];
+        part.generation.store(0, std::memory_order_relaxed);
+
+        _parts[p] = &part;
+        _lfos[p] = nullptr;
     }
+    reset();
 }
 
 engine::~engine() {
-    for (auto &&v : _voices) {
-        delete v;
+    delete_bank(_bank, _poly);
+    delete[] _voices;
+    for (auto &&l : _lfos) {
+        delete l;
     }
 }
 
 void
-engine::update() {
-    _patch = _globals->patch.get();
-    for (auto &&v : _voices) {
-        v->update(_patch);
+engine::allocate(int poly) {
+    if (_bank != nullptr) {
+        delete_bank(_bank, _poly);
+        delete[] _voices;
+    }
+
+    _poly = std::max(poly, max_parts);
+    _bank = new_bank(_globals, _poly);
+    _voices = new voice *[_poly];
+    for (int i = 0; i < _poly; ++i) {
+        _voices[i] = &_bank[i];
+        _voices[i]->skip(_counter); // in step with the engine
+        _voices[i]->update(_patches[0]);
+    }
+    _now = 0ULL;
+    _shown = _voices[0];
+    _released.clear();
+    _released.reserve(_poly);
+}
+
+void
+engine::reset() {
+    _now = 0ULL;
+    _counter = 0;
+    _stolen = 0;
+    _culled = 0;
+    _control_drops = 0;
+    _calm = 0;
+    _globals->control_shift = 0;
+    _events = 0;
+    _patch_swaps = 0;
+    _patch_serial = 0;
+    for (int p = 0; p < max_parts; ++p) {
+        auto &part = _globals->parts[p];
+        part.lfo.shared = false;
+        part.lfo.flat = false;
+        part.lfo.osc = 0;
+        part.lfo.neg = false;
+        part.lfo.out = 0;
+        part.mod_wheel = 0;
+        part.pitch_bend = 0;
+        part.sustain_pedal = false;
+        clear_params(p);
+
+        // whatever the part holds now is picked up again at the next generation
+        _patches[p] = nullptr;
+        _hashes[p] = 0;
+        _expr[p] = 0;
+        _generation[p] = part.generation.load(std::memory_order_acquire);
+        part.held.store(nullptr, 0);
+
+        delete _lfos[p];
+        _lfos[p] = new lfo(_globals, _parts[p]);
+    }
+    allocate(_poly);
+}
+
+void
+engine::update(int p) {
+    TRACE_SCOPE("engine::update");
+    patch const *patch = _globals->parts[p].patch.get();
+    bool const rewire = (patch == _patches[p]);
+    _patches[p] = patch;
+    _hashes[p] = (_cache != nullptr) ? patch_hash(patch) : 0;
+    _patch_swaps++;
+    _patch_serial++;
+    if (!rewire) {
+        clear_params(p);
+    }
+    for (int i = 0; i < _poly; ++i) {
+        auto *voice = _voices[i];
+        if (voice->get_part() != p) {
+            continue;
+        }
+        if (voice->get_patch() == patch) {
+            if (rewire) {
+                voice->update(patch, false);
+            }
+        } else if (voice->idle()) {
+            voice->update(patch);
+        }
+    }
+    _lfos[p]->share(patch == nullptr ? nullptr : patch->lfo.get(), &_globals->parts[p].lfo);
+}
+
+void
+engine::sync() {
+    patch const *held[max_parts][held_patches::max];
+    int count[max_parts];
+    int const n = parts();
+
+    for (int p = 0; p < n; ++p) {
+        auto &part = _globals->parts[p];
+        unsigned const g = part.generation.load(std::memory_order_acquire);
+        if (g != _generation[p]) {
+            _generation[p] = g;
+            update(p);
+        }
+        held[p][0] = _patches[p];
+        count[p] = 1;
+    }
+
+    for (int i = 0; i < _poly; ++i) {
+        auto *voice = _voices[i];
+        int const p = voice->get_part();
+        patch const *patch = voice->get_patch();
+        if (p >= n || patch == _patches[p]) {
+            continue;
+        }
+        if (voice->idle()) {
+            // released since the last block; done with its old patch
+            voice->update(_patches[p]);
+        } else if (count[p] >= 0 && std::find(held[p], held[p] + count[p], patch) == held[p] + count[p]) {
+            if (count[p] == held_patches::max) {
+                count[p] = -1; // too many to report; the producer keeps every patch
+            } else {
+                held[p][count[p]++] = patch;
+            }
+        }
+    }
+
+    for (int p = 0; p < n; ++p) {
+        _globals->parts[p].held.store(held[p], count[p]);
     }
 }
 
 void
 engine::start(int channel, int key, int velocity) {
-    if (_patch == nullptr) {
+    int const part = part_of(channel);
+    patch const *patch = _patches[part];
+    if (patch == nullptr) {
+        return;
+    }
+    // keys the tuning leaves unmapped play nothing
+    if (velocity > 0 && patch->keys != nullptr &&
+        patch->keys->lookup(key, patch->middle_c) == key_table::unmapped) {
         return;
     }
 
-    int v = 0; // voices are kept in a minheap by oldest use (unless mono)
+    int v = -1;
 
-    if (_patch->mono) {
+    // single timbral mono plays one voice per channel outside of the minheap.
+    // multi timbral mono plays the part's sounding voice, if it has one.
+    bool const fixed = patch->mono && !_globals->multi;
+    if (fixed) {
         v = channel;
     } else {
+        // more than one voice may have played the key: the one holding it,
+        // else the latest. never by place in the heap, which snapshots don't keep.
         for (int i = 0; i < _poly; ++i) {
-            if (_voices[i]->get_key() == key) {
+            auto const *voice = _voices[i];
+            if (voice->get_part() != part ||
+                !(patch->mono ? !voice->idle() : voice->get_key() == key)) {
+                continue;
+            }
+            if (v < 0 || voice->triggered() > _voices[v]->triggered() ||
+                (voice->triggered() == _voices[v]->triggered() &&
+                 voice->get_priority() > _voices[v]->get_priority())) {
                 v = i;
-                break;
             }
         }
     }
+    if (v < 0) {
+        if (velocity == 0) {
+            // a stray key up, or the note's voice was stolen (possibly by
+            // another part, whose note it must not cut)
+            return;
+        }
+        v = 0; // voices are kept in a minheap by oldest use (unless mono)
+    }
 
     voice *voice = _voices[v];
-    _globals->status->voice = voice->get_status();
-    voice->start(_patch, key, velocity);
+    if (velocity == 0) {
+        // the note releases on the patch it started with, which may be
+        // older than the part's; sync() moves the voice on once it is idle.
+        voice->start(voice->get_patch(), key, 0);
+    } else {
+        if (!fixed && !voice->idle() &&
+            (voice->get_part() != part || (!patch->mono && voice->get_key() != key))) {
+            _stolen++;
+        }
+        if (voice->get_part() != part || voice->get_patch() != patch) {
+            // starting or stealing a voice last played by another part, or
+            // on an older patch
+            voice->set_part(part);
+            voice->update(patch);
+        }
+        voice->set_cache(_cache, _hashes[part]);
+        voice->start(patch, key, velocity);
+        _lfos[part]->share(patch->lfo.get(), &_globals->parts[part].lfo);
+    }
+    _shown = voice;
 
-    if (!_patch->mono) {
+    if (!fixed) {
         // mark playing voice as currently now and fix it up in the minheap
         // now will overflow after 584 million years playing 1000 notes/sec
         voice->set_priority(++_now);
@@ -100,17 +294,20 @@ engine::start(int channel, int key, int velocity) {
 
 void
 engine::pressure(int channel, int key, int pressure) {
-    if (_patch == nullptr) {
+    int const part = part_of(channel);
+    patch const *patch = _patches[part];
+    if (patch == nullptr) {
         return;
     }
-    if (_patch->mono) {
+    if (patch->mono && !_globals->multi) {
         auto &v = _voices[channel];
         if (key == -1 || v->get_key() == key) {
             v->pressure(pressure);
         }
     } else {
-        for (auto &v : _voices) {
-            if (key == -1 || v->get_key() == key) {
+        for (int i = 0; i < _poly; ++i) {
+            auto &v = _voices[i];
+            if (v->get_part() == part && (key == -1 || v->get_key() == key)) {
                 v->pressure(pressure);
             }
         }
@@ -119,25 +316,314 @@ engine::pressure(int channel, int key, int pressure) {
 
 int
 engine::step() {
-    auto &mod = _globals->mod_wheel;
-    if (mod < _expr) {
-        ++mod;
+    int out;
+    render(&out, 1);
+    return out;
+}
+
+// a part's automation after that many samples
+static void
+ramp(part &part, uint64_t samples) {
+    if (!part.automated) {
+        return;
     }
-    else if (mod > _expr) {
-        --mod;
+    for (auto &param : part.params) {
+        if (param.remaining > 0) {
+            param.ramp(samples);
+        }
     }
+}
 
-    int out = 0;
-    for (auto &&v : _voices) {
-        out += v->step();
+void
+engine::render(int *out, int count) {
+    render(out, nullptr, count);
+}
+
+void
+engine::render(int *out, int *side, int count) {
+    TRACE_SCOPE("engine::render");
+    std::fill_n(out, count, 0);
+    if (side != nullptr) {
+        std::fill_n(side, count, 0);
+    }
+
+    // spans up to the next group boundary, where the voices render the 16
+    // samples ahead. the mod wheel is only read by a group rendered on the
+    // first sample of a span, so it moves one sample there and the rest of
+    // the span at once. past that, the voices only copy out what they have.
+    int const n = parts();
+    while (count > 0) {
+        int const span = std::min(count, 16 - (int)(_counter & 0x0f));
+
+        // the shared lfos step at the same control tick as the voices
+        bool const tick = (_counter & 0x0f) == 0 && ((_counter >> 4) & _globals->eg_mask) == 0;
+        for (int p = 0; p < n; ++p) {
+            auto &part = _globals->parts[p];
+            part.mod_wheel = smooth(part.mod_wheel, _expr[p], 1);
+            ramp(part, 1);
+            if (tick) {
+                _lfos[p]->step(&part.lfo);
+            }
+        }
+
+        // in bank order: mixing is a sum, so heap order doesn't matter
+        for (int i = 0; i < _poly; ++i) {
+            _bank[i].mix(out, side, span);
+        }
+
+        for (int p = 0; p < n; ++p) {
+            auto &part = _globals->parts[p];
+            part.mod_wheel = smooth(part.mod_wheel, _expr[p], span - 1);
+            ramp(part, span - 1);
+        }
+
+        _counter += span;
+        out += span;
+        if (side != nullptr) {
+            side += span;
+        }
+        count -= span;
+    }
+}
+
+void
+engine::param(int p, int id, int value, int ramp) {
+    if (p < 0 || p >= max_parts || id < 0 || id >= param_count) {
+        return;
+    }
+    auto &part = _globals->parts[p];
+    auto &param = part.params[id];
+    if (!param.set || ramp <= 0) {
+        // from the patch's own value, if it was, is a jump
+        param.value = value;
+    }
+    param.set = true;
+    param.target = value;
+    param.remaining = std::max(ramp, 0);
+    part.automated = true;
+}
+
+void
+engine::clear_params(int p) {
+    auto &part = _globals->parts[p];
+    for (auto &param : part.params) {
+        param = automation{};
+    }
+    part.automated = false;
+}
+
+void
+engine::load(double used) {
+    if (used > shed_high) {
+        _calm = 0;
+        if (cull()) {
+            return;
+        }
+        if (_globals->control_shift < max_control_shift) {
+            _globals->control_shift++;
+            _control_drops++;
+        }
+    } else if (used < shed_low && _globals->control_shift > 0) {
+        if (++_calm >= shed_calm) {
+            _globals->control_shift--;
+            _calm = 0;
+        }
+    } else {
+        _calm = 0;
+    }
+}
+
+// the quietest quarter of the released voices still sounding, at least one.
+// false if there are none.
+bool
+engine::cull() {
+    _released.clear();
+    for (int i = 0; i < _poly; ++i) {
+        if (!_bank[i].triggered() && !_bank[i].idle()) {
+            _released.push_back(&_bank[i]);
+        }
+    }
+    if (_released.empty()) {
+        return false;
+    }
+
+    size_t const n = std::max(_released.size() / 4, (size_t)1);
+    std::nth_element(_released.begin(), _released.begin() + (n - 1), _released.end(),
+                     [](voice const *a, voice const *b) { return a->level() < b->level(); });
+    for (size_t i = 0; i < n; ++i) {
+        _released[i]->cull();
+    }
+    _culled += (int)n;
+    return true;
+}
+
+void
+engine::take_stats(block_stats *stats) {
+    int active = 0;
+    for (int i = 0; i < _poly; ++i) {
+        if (!_bank[i].idle()) {
+            active++;
+        }
+    }
+    stats->active_voices = active;
+    stats->voices_stolen = _stolen;
+    stats->voices_culled = _culled;
+    stats->control_drops = _control_drops;
+    stats->control_shift = _globals->control_shift;
+    stats->events = _events;
+    stats->patch_swaps = _patch_swaps;
+    stats->patch_serial = _patch_serial;
+
+    _stolen = 0;
+    _culled = 0;
+    _control_drops = 0;
+    _events = 0;
+    _patch_swaps = 0;
+}
+
+void
+engine::get_status(struct status *s) const {
+    s->playing = !_shown->idle();
+    _shown->get_status(&s->voice);
+}
+
+void
+engine::set_cache(note_cache *cache) {
+    _cache = cache;
+    for (int p = 0; p < max_parts; ++p) {
+        _hashes[p] = (cache != nullptr && _patches[p] != nullptr) ? patch_hash(_patches[p]) : 0;
+    }
+    for (int i = 0; i < _poly; ++i) {
+        _voices[i]->set_cache(cache, 0);
+    }
+}
+
+static const uint64_t snapshot_magic = 0x6e736d6665727570ULL; // "purefmsn"
+static const uint32_t snapshot_version = 4;
+
+void
+engine::snapshot(std::vector<uint8_t> *out, bool canonical) {
+    out->clear();
+    state_writer a(out);
+
+    uint64_t magic = snapshot_magic;
+    uint32_t version = snapshot_version;
+    a(magic);
+    a(version);
+    a(_poly);
+    a(_globals->eg_mask);
+    a(_globals->multi);
+
+    // only the heap picks which poly voice plays next; fixed mono voices and
+    // parts keep their places
+    if (!canonical || _globals->multi || (_patches[0] != nullptr && _patches[0]->mono)) {
+        state(a);
+        for (int i = 0; i < _poly; ++i) {
+            _voices[i]->snapshot(a);
+        }
+        return;
+    }
+
+    // priorities by rank, with never used voices staying 0
+    std::vector<uint64_t> ranks;
+    for (int i = 0; i < _poly; ++i) {
+        if (_voices[i]->get_priority() != 0) {
+            ranks.push_back(_voices[i]->get_priority());
+        }
+    }
+    std::sort(ranks.begin(), ranks.end());
+    ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+
+    std::vector< std::pair<uint64_t, std::vector<uint8_t> > > voices(_poly);
+    for (int i = 0; i < _poly; ++i) {
+        auto *voice = _voices[i];
+        uint64_t const priority = voice->get_priority();
+        uint64_t const rank = priority == 0 ? 0 :
+            (uint64_t)(std::lower_bound(ranks.begin(), ranks.end(), priority) - ranks.begin()) + 1;
+
+        state_writer v(&voices[i].second);
+        voice->set_priority(rank);
+        voice->snapshot(v);
+        voice->set_priority(priority);
+        voices[i].first = rank;
+    }
+    // ascending priority is a heap as it stands
+    std::sort(voices.begin(), voices.end());
+
+    uint64_t const now = _now;
+    _now = ranks.size();
+    state(a);
+    _now = now;
+    for (auto const &v : voices) {
+        out->insert(out->end(), v.second.begin(), v.second.end());
+    }
+}
+
+bool
+engine::restore(std::vector<uint8_t> const &in) {
+    state_reader a(in);
+
+    uint64_t magic = 0;
+    uint32_t version = 0;
+    int poly = 0;
+    unsigned eg_mask = 0;
+    bool multi = false;
+    a(magic);
+    a(version);
+    a(poly);
+    a(eg_mask);
+    a(multi);
+    if (!a.ok() || magic != snapshot_magic || version != snapshot_version ||
+        poly < max_parts || eg_mask != _globals->eg_mask || multi != _globals->multi) {
+        return false;
+    }
+    if (poly != _poly) {
+        allocate(poly);
+    }
+
+    for (int p = 0; p < max_parts; ++p) {
+        _lfos[p]->share(_patches[p] == nullptr ? nullptr : _patches[p]->lfo.get(), &_globals->parts[p].lfo);
+    }
+    state(a);
+    for (int i = 0; i < _poly; ++i) {
+        auto *voice = _voices[i];
+        voice->restore(a);
+        int const p = voice->get_part();
+        voice->update(_patches[p], false);
+    }
+    return a.ok();
+}
+
+void
+engine::skip(uint64_t frames) {
+    // control ticks in the frames skipped
+    unsigned const period = 16 * (_globals->eg_mask + 1);
+    uint64_t const first = (period - (_counter % period)) % period;
+    uint64_t const ticks = frames > first ? (frames - first - 1) / period + 1 : 0;
+
+    for (int p = 0, n = parts(); p < n; ++p) {
+        auto &part = _globals->parts[p];
+        part.mod_wheel = smooth(part.mod_wheel, _expr[p], frames);
+        ramp(part, frames);
+        for (uint64_t t = 0; t < ticks; ++t) {
+            _lfos[p]->step(&part.lfo);
+        }
+    }
+
+    _counter += (unsigned)frames;
+    for (int i = 0; i < _poly; ++i) {
+        _bank[i].skip(frames);
     }
-    return out;
 }
 
 void
 engine::midi(const unsigned char *msg) {
+    TRACE_SCOPE("engine::midi");
+    _events++;
+
     unsigned char cmd = msg[0];
     unsigned char channel = cmd & 0x0f;
+    int const p = part_of(channel);
     switch(cmd & 0xf0) {
     case 0x80: // note off
         start(channel, msg[1], 0);
@@ -154,13 +640,13 @@ engine::midi(const unsigned char *msg) {
     case 0xb0: // control
         switch(msg[1]) {
             case 64: // sustain pedal
-                _globals->sustain_pedal = (msg[2] != 0);
+                _globals->parts[p].sustain_pedal = (msg[2] != 0);
                 break;
 
             default:
-                if (_patch != nullptr &&
-                    (msg[1] == _patch->expr1 || msg[1] == _patch->expr2)) {
-                    _expr = (int)msg[2] << 5;
+                if (_patches[p] != nullptr &&
+                    (msg[1] == _patches[p]->expr1 || msg[1] == _patches[p]->expr2)) {
+                    _expr[p] = (int)msg[2] << 5;
                 }
                 break;
         }
@@ -171,7 +657,7 @@ engine::midi(const unsigned char *msg) {
         break;
         
     case 0xe0: // pitch bend
-        _globals->pitch_bend = (((int)msg[1] + ((int)(msg[2]) << 7)) - 0x2000) << 2;
+        _globals->parts[p].pitch_bend = (((int)msg[1] + ((int)(msg[2]) << 7)) - 0x2000) << 2;
         break;
     }
 }
@@ -10,31 +10,142 @@
 #define engine_hpp
 
 #include "algo.hpp"
+#include "cache.hpp"
 #include "voice.hpp"
+#include "lfosc.hpp"
 #include "globals.hpp"
+#include "state.hpp"
+#include "status.h"
+
+#include <cstdint>
+#include <vector>
 
 class engine {
     public:
-        engine(globals *);
-        virtual ~engine();
+        engine(globals *, int poly = 16);
+        ~engine();
+
+        // (re)allocate the shared voice pool of at least 16 voices.
+        // not while rendering.
+        void allocate(int poly);
+
+        // back to the state of a new engine without reallocating tables,
+        // keeping the voice count. the next patch generation is picked up by sync().
+        void reset();
+
+        // pick up the patch of a part (any midi channel when not multi timbral).
+        // sounding voices finish on the patch they started with; setting the
+        // same patch again rewires them to it without a reset. a new patch
+        // drops the part's automation (param()), which was against the old one.
+        void update(int part = 0);
 
-        void update();
+        // at a block boundary: update parts with a new patch generation and
+        // report the patches still sounding back to the producer.
+        void sync();
         void midi(unsigned char const *msg);
         int step();
+        void render(int *out, int count);
+
+        // out as above, the mid of the stereo pair, and side (algo::step())
+        // beside it if not null: left is out - side, right out + side.
+        void render(int *out, int *side, int count);
+
+        // automate a part's parameter (param_id) from this sample, in place of
+        // the patch's own value, reaching value in a straight line over ramp
+        // samples. values are in patch units. clear_params() goes back to
+        // the patch for all of them.
+        void param(int part, int id, int value, int ramp = 0);
+        void clear_params(int part);
+
+        // load shedding, from the fraction of its time the last render block
+        // took to render. above shed_high, the next block sheds a step of load:
+        // the quietest released voices first, then the op control rate, by
+        // half each time. after shed_calm blocks below shed_low, the control
+        // rate comes back a step.
+        void load(double used);
+
+        static constexpr double shed_high = 0.85;
+        static constexpr double shed_low = 0.5;
+        static constexpr int shed_calm = 100;
+        static constexpr int max_control_shift = 2;
+
+        // fill in and reset the engine's counters for a render block
+        void take_stats(block_stats *);
+
+        // envelope stages and outputs of the voice last started, between
+        // render blocks
+        void get_status(struct status *) const;
+
+        // play back and record notes through a cache, or nullptr for none.
+        // not while rendering.
+        void set_cache(note_cache *);
+
+        // the running state of every voice in heap order, the shared lfos and
+        // the parts' controllers. restore into an engine at the same eg rate
+        // with the same patches picked up by sync(); voices are rebound to
+        // their part's current patch. bit exact except for noise (rand()).
+        // a failed restore leaves the engine to be reset().
+        //
+        // a canonical snapshot lists poly voices by priority, renumbered from 1,
+        // so two engines which will play the same from here snapshot the same
+        // however their voices came to be where they are. it restores as well.
+        void snapshot(std::vector<uint8_t> *, bool canonical = false);
+        bool restore(std::vector<uint8_t> const &);
+
+        // advance the clock, the shared lfos and controller smoothing as if
+        // rendering that many frames, without running the voices. for starting
+        // a new engine part way into a song ahead of a lead-in.
+        void skip(uint64_t frames);
 
     private:
+        int part_of(int channel) const { return _globals->multi ? channel : 0; }
+        int parts() const { return _globals->multi ? max_parts : 1; }
         void start(int channel, int key, int velocity);
         void pressure(int channel, int key, int pressure);
+        bool cull();
 
-    private:
-        static constexpr int _poly = 16; // must be at least 16
+        template<class Archive>
+        void state(Archive &a) {
+            a(_counter);
+            a(_now);
+            a(_expr);
+            for (int p = 0; p < max_parts; ++p) {
+                auto &part = _globals->parts[p];
+                a(part.lfo);
+                a(part.mod_wheel);
+                a(part.pitch_bend);
+                a(part.sustain_pedal);
+                a(part.params);
+                a(part.automated);
+                _lfos[p]->serialize(a);
+            }
+        }
 
+    private:
         globals *_globals;
-        voice *_voices[_poly];
-        patch const *_patch;
-        int _round; // rotating voice allocation
-        int _expr; // expression input
+        voice *_bank; // every voice, in one cache aligned block
+        voice **_voices; // the bank, as a minheap by oldest use (unless mono)
+        int _poly; // at least 16
+        patch const *_patches[max_parts];
+        part const *_parts[max_parts];
+        lfo *_lfos[max_parts]; // free running lfo shared by all voices of a part
+        int _expr[max_parts]; // expression input
+        unsigned _generation[max_parts]; // last patch generation seen
+        note_cache *_cache;
+        uint64_t _hashes[max_parts]; // patch content, when caching
+        unsigned _counter; // control tick counter, in step with the voices
         uint64_t _now; // monotonic "now" for last voice use
+        voice const *_shown; // last started, for status
+        std::vector<voice *> _released; // cull() candidates, sized to the bank
+        int _calm; // blocks in a row under shed_low
+
+        // telemetry counters since the last take_stats()
+        int _stolen;
+        int _culled;
+        int _control_drops;
+        int _events;
+        int _patch_swaps;
+        unsigned _patch_serial;
 
 };
 
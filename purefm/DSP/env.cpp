@@ -8,11 +8,13 @@
 
 #include "env.hpp"
 #include "globals.hpp"
+#include "trace.hpp"
 
 #include <algorithm>
 
-envelope::envelope(globals const *g) {
+envelope::envelope(globals const *g, part const *const &part, int rate_param) : _part(part) {
     _globals = g;
+    _rate_param = rate_param;
     _level = eg_min;
     _out = eg_min;
     _rate_adj = 0;
@@ -26,24 +28,22 @@ envelope::envelope(globals const *g) {
     _run = false;
     _idle = true;
     _type = eg_exp;
-    _status.output = (eg_min >> 12);
-    _status.stage = 0;
 }
 
 envelope::~envelope() {
 }
 
 int
-envelope::pitch_value(int value) {
+envelope::pitch_value(int value) const {
     if (_patch == nullptr) {
         return value;
     }
     return (value >> (8 + _patch->scale)) +
-            (_globals->pitch_bend >> _patch->bend);
+            (_part->pitch_bend >> _patch->bend);
 }
 
 int
-envelope::pitch_bias(int lfo) {
+envelope::pitch_bias(int lfo) const {
     if (_patch == nullptr) {
         return 0;
     }
@@ -51,14 +51,14 @@ envelope::pitch_bias(int lfo) {
 }
 
 int
-envelope::op_bias(int lfo, int pressure) {
+envelope::op_bias(int lfo, int pressure) const {
     if (_patch == nullptr) {
         return 0;
     }
     // mod_wheel value is shifted over 5
     return ((lfo * _patch->lfo) >> 7) +
            ((pressure >> (5 + _patch->after)) << 16) +
-           ((_globals->mod_wheel >> (5 + _patch->expr)) << 16);
+           ((_part->mod_wheel >> (5 + _patch->expr)) << 16);
 }
 
 void
@@ -99,7 +99,7 @@ envelope::start(env_patch const *patch, int level_adj, int rate_adj, bool trigge
         _rate_adj = rate_adj;
         _level_adj = level_adj;
         run();
-    } else if (!_globals->sustain_pedal) {
+    } else if (!_part->sustain_pedal) {
         stop();
     }
 }
@@ -145,7 +145,7 @@ envelope::set(int at) {
             return;
         }
     }
-    _status.stage = at;
+    TRACE_INSTANT("envelope stage", at);
     if (at < 0 || at >= _end) {
         _idle = true;
         return;
@@ -161,6 +161,9 @@ envelope::set(int at) {
     }
 
     int rate = eg->rate - _rate_adj;
+    if (_rate_param >= 0) {
+        rate -= _part->param(_rate_param, 0);
+    }
     if (rate < 0) {
         rate = 0;
     } else if (rate > 0x7f) {
@@ -205,7 +208,7 @@ envelope::set(int at) {
 
 int
 envelope::step(int count, int bias) {
-    if (!_trigger && _run && !_globals->sustain_pedal) {
+    if (!_trigger && _run && !_part->sustain_pedal) {
         stop();
     }
 
@@ -213,9 +216,7 @@ envelope::step(int count, int bias) {
         if (!_idle) {
             set(_at+1);
         } else {
-            int const out = _out + bias;
-            _status.output = out >> 12;
-            return out;
+            return _out + bias;
         }
     }
 
@@ -239,7 +240,15 @@ envelope::step(int count, int bias) {
         break;
     }
 
-    int const out = _out + bias;
-    _status.output = out >> 12;
-    return out;
+    return _out + bias;
+}
+
+// read back for display, never while stepping: the stage running, or past the
+// last once released and done, and the output under the bias given.
+eg_status
+envelope::get_status(int bias) const {
+    eg_status s;
+    s.stage = (_idle && !_run) ? _end : _at;
+    s.output = (_out + bias) >> 12;
+    return s;
 }
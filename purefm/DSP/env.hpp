@@ -10,6 +10,7 @@
 #define env_hpp
 
 #include "globals.hpp"
+#include "state.hpp"
 #include <vector>
 #include <algorithm>
 
@@ -20,7 +21,7 @@ class eg_stage {
             _goal = eg_min;
             _rate = 0;
         }
-        virtual ~eg_stage() {}
+        ~eg_stage() {}
 
         void set(int level, int goal, int rate) {
             _level = level;
@@ -37,6 +38,13 @@ class eg_stage {
         bool done() const { return _level == _goal; }
         int get_level() const { return _level; }
 
+        template<class Archive>
+        void serialize(Archive &a) {
+            a(_level);
+            a(_goal);
+            a(_rate);
+        }
+
         int step(int count) {
             if (!done()) {
                 _level += _rate * count;
@@ -55,10 +63,11 @@ class eg_stage {
 
 class envelope {
     public:
-        envelope(globals const *);
-        virtual ~envelope();
+        // rate_param, if any, is the part's automation of every stage rate
+        envelope(globals const *, part const *const &, int rate_param = -1);
+        ~envelope();
 
-        eg_status const *get_status() const { return &_status; }
+        eg_status get_status(int bias) const;
         void update(env_patch const *, bool reset);
         void start(env_patch const *, int level_adj, int rate_adj, bool trigger);
         int step(int count, int bias);
@@ -66,12 +75,37 @@ class envelope {
         void init_at(int out) { _out = out; _level = out; }
 
         // for pitch envelope
-        int pitch_bias(int lfo);
-        int pitch_value(int value);
-        int op_bias(int lfo, int pressure);
+        int pitch_bias(int lfo) const;
+        int pitch_value(int value) const;
+        int op_bias(int lfo, int pressure) const;
 
         bool idle() const { return _idle && _level == eg_min; }
 
+        // right after start: a running stage's first step overwrites out
+        // before anything reads it, except a delay, which holds it.
+        void settle() {
+            if (!_stage.done() && _type != eg_delay) {
+                _out = 0;
+            }
+        }
+
+        // running state; the patch is not included
+        template<class Archive>
+        void serialize(Archive &a) {
+            a(_level);
+            a(_out);
+            a(_at);
+            a(_type);
+            _stage.serialize(a);
+            a(_trigger);
+            a(_run);
+            a(_idle);
+            a(_key_up);
+            a(_end);
+            a(_level_adj);
+            a(_rate_adj);
+        }
+
     private:
         void run();
         void stop();
@@ -89,10 +123,11 @@ class envelope {
         eg_vec const *_egs;
         int _key_up, _end;
         int _level_adj, _rate_adj;
-        eg_status _status;
+        int _rate_param;
 
         env_patch const *_patch;
         globals const *_globals;
+        part const *const &_part; // running info of the owning voice's part
 };
 
 #endif /* env_hpp */
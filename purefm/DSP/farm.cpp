@@ -0,0 +1,382 @@
+//
+//  farm.cpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#include "farm.hpp"
+#include "cache.hpp"
+#include "engine.hpp"
+#include "smf.hpp"
+#include "wav.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <thread>
+
+render_farm::render_farm(double sampleRate, int threads, size_t cache) : _next(0) {
+    _rate = sampleRate;
+    _cache = cache;
+    _threads = threads > 0 ? threads : std::max(1, (int)std::thread::hardware_concurrency());
+    _tables.init(sampleRate);
+}
+
+render_farm::~render_farm() {
+}
+
+// take every part of a patch through ptr_msg::get() once, so workers sharing
+// the patch only ever read it
+static void
+prime(patch const *p) {
+    auto env = [](env_patch const *e) {
+        if (e != nullptr) {
+            e->egs.get();
+        }
+    };
+    for (auto const &op : p->ops) {
+        if (op != nullptr) {
+            env(op->env.get());
+        }
+    }
+    env(p->pitch_env.get());
+    auto const *l = p->lfo.get();
+    if (l != nullptr) {
+        l->wave.get();
+        env(l->env.get());
+    }
+}
+
+std::vector<bool>
+render_farm::run(std::vector<render_job> const &jobs) {
+    _next = 0;
+    _results.assign(jobs.size(), 0);
+    for (auto const &job : jobs) {
+        if (job.patch != nullptr) {
+            prime(job.patch.get());
+        }
+    }
+
+    int const threads = std::min(_threads, (int)std::max(jobs.size(), (size_t)1));
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) {
+        pool.emplace_back(&render_farm::worker, this, std::cref(jobs));
+    }
+    worker(jobs);
+    for (auto &&t : pool) {
+        t.join();
+    }
+
+    return std::vector<bool>(_results.begin(), _results.end());
+}
+
+void
+render_farm::worker(std::vector<render_job> const &jobs) {
+    globals g(_tables);
+    g.eg_mask = eg_rate_mask(_rate);
+
+    note_cache cache(_cache); // outlives the engine's voices
+    engine e(&g);
+    if (_cache > 0) {
+        e.set_cache(&cache);
+    }
+    patch_publisher publisher;
+    smf_reader reader;
+    std::vector<midi_event> events;
+    int buffer[64];
+    wav_writer wav;
+
+    for (size_t i = _next++; i < jobs.size(); i = _next++) {
+        auto const &job = jobs[i];
+
+        if (job.patch == nullptr || !reader.open(job.midi.c_str(), _rate) ||
+            !wav.open(job.output.c_str(), (int)_rate)) {
+            continue;
+        }
+
+        e.reset();
+        publisher.publish(&g.parts[0], job.patch);
+        e.sync();
+
+        // without a length, the end is known once the last event is read
+        uint64_t end = UINT64_MAX;
+        if (job.length > 0.0) {
+            end = (uint64_t)std::llround(job.length * _rate);
+        }
+
+        // the midi file is read a block at a time; events land on their exact
+        // frame within the block
+        bool more = true;
+        bool ok = true;
+        for (uint64_t frame = 0; frame < end; ) {
+            uint64_t const block = std::min(end, frame + 64);
+            events.clear();
+            if (more) {
+                more = reader.read(block, &events);
+                if (!more && job.length <= 0.0) {
+                    end = reader.last() + (uint64_t)std::llround(tail * _rate);
+                }
+            }
+
+            size_t next = 0;
+            while (frame < block && frame < end) {
+                while (next < events.size() && events[next].frame <= frame) {
+                    e.midi(events[next++].data);
+                }
+                uint64_t stop = std::min(block, end);
+                if (next < events.size()) {
+                    stop = std::min(stop, events[next].frame);
+                }
+                int const count = (int)(stop - frame);
+                e.render(buffer, count);
+                ok = wav.write(buffer, count) && ok;
+                frame = stop;
+            }
+        }
+        ok = !reader.error() && ok;
+        reader.close();
+
+        _results[i] = wav.close() && ok;
+    }
+}
+
+// MARK: split renders
+
+struct render_farm::chunk {
+    uint64_t start;                 // frames
+    uint64_t end;
+    std::vector<int> samples;
+    std::vector<uint8_t> begin;     // canonical snapshot after the lead-in
+    std::vector<uint8_t> finish;    // canonical snapshot at the end
+    bool done;
+};
+
+// an engine of its own, on the job's patch
+struct split_rig {
+    globals g;
+    std::unique_ptr<engine> e;
+    patch_publisher publisher;
+
+    split_rig(tables const &t, double rate, patch_ptr::pointer const &patch) : g(t) {
+        g.eg_mask = eg_rate_mask(rate);
+        e.reset(new engine(&g));
+        publisher.publish(&g.parts[0], patch);
+        e->sync();
+    }
+};
+
+// render frames [from, to), playing events from *next on as they fall due.
+// the samples go to out unless it is nullptr.
+static void
+play(engine &e, std::vector<midi_event> const &events, size_t *next,
+     uint64_t from, uint64_t to, std::vector<int> *out) {
+    int buffer[64];
+    for (uint64_t frame = from; frame < to; ) {
+        while (*next < events.size() && events[*next].frame <= frame) {
+            e.midi(events[(*next)++].data);
+        }
+        uint64_t stop = std::min(to, frame + 64);
+        if (*next < events.size()) {
+            stop = std::min(stop, events[*next].frame);
+        }
+        int const count = (int)(stop - frame);
+        e.render(buffer, count);
+        if (out != nullptr) {
+            out->insert(out->end(), buffer, buffer + count);
+        }
+        frame = stop;
+    }
+}
+
+// the shared lfo draws noise from rand(), which no two engines share
+static bool
+noisy(patch const *p) {
+    auto const *l = p->lfo.get();
+    return l != nullptr && dynamic_cast<noise const *>(l->wave.get()) != nullptr;
+}
+
+// frames a tail's length after the last key and pedal came up, with nothing
+// before the next event, at least a chunk apart
+std::vector<uint64_t>
+render_farm::silences(std::vector<midi_event> const &events, uint64_t end) const {
+    uint64_t const settle = (uint64_t)std::llround(tail * _rate);
+    uint64_t const shortest = (uint64_t)std::llround(split_chunk * _rate);
+
+    std::vector<uint64_t> splits;
+    bool down[16][128] = {};
+    bool pedal[16] = {};
+    int held = 0;
+    int pedals = 0;
+    uint64_t last = 0;
+
+    for (size_t i = 0; i < events.size(); ++i) {
+        auto const *data = events[i].data;
+        int const channel = data[0] & 0x0f;
+        int const key = data[1] & 0x7f;
+        switch (data[0] & 0xf0) {
+        case 0x90:
+            if (data[2] != 0) {
+                held += !down[channel][key];
+                down[channel][key] = true;
+                break;
+            }
+            // fall through
+        case 0x80:
+            held -= down[channel][key];
+            down[channel][key] = false;
+            break;
+
+        case 0xb0:
+            if (data[1] == 64) {
+                pedals += (data[2] != 0) - pedal[channel];
+                pedal[channel] = (data[2] != 0);
+            }
+            break;
+        }
+
+        if (held > 0 || pedals > 0) {
+            continue;
+        }
+        uint64_t const at = events[i].frame + settle;
+        uint64_t const next = i + 1 < events.size() ? events[i + 1].frame : end;
+        if (at < next && at < end && at - last >= shortest) {
+            splits.push_back(at);
+            last = at;
+        }
+    }
+    return splits;
+}
+
+void
+render_farm::chunk_worker(render_job const &job, std::vector<midi_event> const &events,
+                          std::vector<chunk> *chunks) {
+    uint64_t const lead = (uint64_t)std::llround(split_lead * _rate);
+
+    for (size_t i = _next++; i < chunks->size(); i = _next++) {
+        auto &c = (*chunks)[i];
+        split_rig r(_tables, _rate, job.patch);
+
+        // the first chunk starts as the song does. the others take the
+        // controllers as they stand ahead of the lead-in, skip to it and
+        // play it through.
+        size_t next = 0;
+        if (i > 0) {
+            uint64_t const from = c.start > lead ? c.start - lead : 0;
+            for (; next < events.size() && events[next].frame < from; ++next) {
+                switch (events[next].data[0] & 0xf0) {
+                case 0xb0:
+                case 0xd0:
+                case 0xe0:
+                    r.e->midi(events[next].data);
+                    break;
+                }
+            }
+            r.e->skip(from);
+            play(*r.e, events, &next, from, c.start, nullptr);
+            r.e->snapshot(&c.begin, true);
+        }
+        play(*r.e, events, &next, c.start, c.end, &c.samples);
+        r.e->snapshot(&c.finish, true);
+
+        std::lock_guard<std::mutex> lock(_lock);
+        c.done = true;
+        _done.notify_all();
+    }
+}
+
+bool
+render_farm::run_split(render_job const &job, split_stats *stats) {
+    split_stats counts = { 0, 0, 0 };
+    if (stats != nullptr) {
+        *stats = counts;
+    }
+    if (job.patch == nullptr) {
+        return false;
+    }
+    prime(job.patch.get());
+
+    // the silences are only known with the whole song in hand
+    smf_reader reader;
+    std::vector<midi_event> events;
+    if (!reader.open(job.midi.c_str(), _rate)) {
+        return false;
+    }
+    while (reader.read(UINT64_MAX, &events)) {
+    }
+    bool ok = !reader.error();
+    uint64_t end = reader.last() + (uint64_t)std::llround(tail * _rate);
+    reader.close();
+    if (!ok) {
+        return false;
+    }
+
+    if (job.length > 0.0) {
+        end = (uint64_t)std::llround(job.length * _rate);
+    }
+
+    std::vector<uint64_t> starts(1, 0);
+    if (!job.patch->mono && !noisy(job.patch.get())) {
+        auto const splits = silences(events, end);
+        starts.insert(starts.end(), splits.begin(), splits.end());
+    }
+    std::vector<chunk> chunks(starts.size());
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        chunks[i].start = starts[i];
+        chunks[i].end = i + 1 < starts.size() ? starts[i + 1] : end;
+        chunks[i].done = false;
+    }
+    counts.chunks = (int)chunks.size();
+
+    wav_writer wav;
+    if (!wav.open(job.output.c_str(), (int)_rate)) {
+        return false;
+    }
+
+    _next = 0;
+    int const threads = std::min(_threads, (int)chunks.size());
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back(&render_farm::chunk_worker, this, std::cref(job), std::cref(events), &chunks);
+    }
+
+    // chunks are checked and written in order as they come in. truth is the
+    // canonical state the song is really in at the start of the next chunk.
+    std::vector<uint8_t> truth;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        auto &c = chunks[i];
+        {
+            std::unique_lock<std::mutex> lock(_lock);
+            _done.wait(lock, [&c]() { return c.done; });
+        }
+
+        if (i > 0 && c.begin == truth) {
+            counts.matched++;
+        } else if (i > 0) {
+            split_rig r(_tables, _rate, job.patch);
+            if (r.e->restore(truth)) {
+                size_t next = std::lower_bound(events.begin(), events.end(), c.start,
+                    [](midi_event const &e, uint64_t frame) { return e.frame < frame; }) - events.begin();
+                c.samples.clear();
+                play(*r.e, events, &next, c.start, c.end, &c.samples);
+                r.e->snapshot(&c.finish, true);
+            } else {
+                ok = false;
+            }
+            counts.rendered++;
+        }
+
+        ok = wav.write(c.samples.data(), (int)c.samples.size()) && ok;
+        std::vector<int>().swap(c.samples);
+        truth.swap(c.finish);
+    }
+
+    for (auto &&t : pool) {
+        t.join();
+    }
+    if (stats != nullptr) {
+        *stats = counts;
+    }
+    return wav.close() && ok;
+}
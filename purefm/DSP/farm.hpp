@@ -0,0 +1,81 @@
+//
+//  farm.hpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#ifndef farm_hpp
+#define farm_hpp
+
+#include "globals.hpp"
+#include "tables.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// offline renders of (patch, midi file) jobs to wave files. each worker
+// thread keeps one engine for every job it takes; all share one set of tables.
+
+struct render_job {
+    patch_ptr::pointer patch;
+    std::string midi;       // standard midi file
+    double length;          // seconds, or <= 0 for the midi file plus a release tail
+    std::string output;     // wave file
+};
+
+struct midi_event;
+
+struct split_stats {
+    int chunks;
+    int matched;    // lead-in ended where the chunk before it did
+    int rendered;   // rendered again from where the chunk before it ended
+};
+
+class render_farm {
+    public:
+        // threads 0 for one per core. with a cache budget (bytes), each
+        // worker replays notes it has already rendered from a note cache.
+        render_farm(double sampleRate, int threads = 0, size_t cache = 0);
+        virtual ~render_farm();
+
+        int threads() const { return _threads; }
+
+        // true for each job written completely
+        std::vector<bool> run(std::vector<render_job> const &jobs);
+
+        // one long job split where the song falls silent, its chunks rendered
+        // on every thread. a chunk starts from a lead-in of the song before it
+        // and is kept if that leaves the engine as the chunk before it ended;
+        // otherwise it is rendered again from there. the output is the same
+        // as run() writes either way.
+        bool run_split(render_job const &job, split_stats *stats = nullptr);
+
+        static constexpr double tail = 2.0; // seconds after the last event
+        static constexpr double split_lead = 10.0; // seconds of lead-in per chunk
+        static constexpr double split_chunk = 30.0; // shortest chunk in seconds
+
+    private:
+        struct chunk;
+
+        void worker(std::vector<render_job> const &jobs);
+        void chunk_worker(render_job const &job, std::vector<midi_event> const &events,
+                          std::vector<chunk> *chunks);
+        std::vector<uint64_t> silences(std::vector<midi_event> const &events, uint64_t end) const;
+
+    private:
+        double _rate;
+        int _threads;
+        size_t _cache;
+        tables _tables;
+        std::atomic<size_t> _next;
+        std::vector<char> _results; // not vector<bool>, written from every worker
+        std::mutex _lock;
+        std::condition_variable _done; // a chunk is rendered
+};
+
+#endif /* farm_hpp */
@@ -12,7 +12,12 @@
 #include "tables.hpp"
 #include "status.h"
 
+#include <algorithm>
 #include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -59,6 +64,14 @@ class ptr_msg {
             return _used.get();
         }
 
+        // producer: the message the consumer took last, only to compare
+        T const *used() const {
+            while (_fence.test_and_set());
+            T const *p = _used.get();
+            _fence.clear();
+            return p;
+        }
+
     private:
         // next: potentially new value waiting for engine
         // used: currently used value by engine
@@ -84,7 +97,7 @@ struct eg {
 };
 typedef std::shared_ptr<eg> eg_ptr;
 
-typedef std::vector<eg_ptr const> eg_vec;
+typedef std::vector<eg_ptr> eg_vec;
 typedef ptr_msg< eg_vec > eg_vec_ptr;
 
 struct env_patch {
@@ -103,6 +116,20 @@ typedef ptr_msg< env_patch > env_patch_ptr;
 const int scale_up = 0x01;
 const int scale_exp = 0x02;
 
+// op waveforms, after the OPL3's eight. each is a log table lookup rendered
+// by a kernel of its own (op::render<>()), so none costs more than the sine.
+typedef enum {
+    op_wave_sine = 0,
+    op_wave_half_sine,      // the positive half, then silence
+    op_wave_abs_sine,       // the positive half twice
+    op_wave_pulse_sine,     // rising quarters only, each followed by silence
+    op_wave_alt_sine,       // a whole sine in the first half, then silence
+    op_wave_camel_sine,     // two positive halves in the first half, then silence
+    op_wave_square,
+    op_wave_log_saw,        // exponential fall each half, the second negated
+    op_wave_count
+} op_wave;
+
 struct op_patch {
     int mod;
     int sum;
@@ -118,6 +145,8 @@ struct op_patch {
     int scale_type_right;
     int frequency;
     bool fixed;
+    int feedback;   // of this op's output fed back into the algorithm, or -1 for the patch's
+    int wave;       // op_wave
 
     env_patch_ptr env;
 };
@@ -146,6 +175,26 @@ struct lfo_patch {
 };
 typedef ptr_msg<lfo_patch> lfo_patch_ptr;
 
+// the pitch of every midi key, as played with middle_c at 60, in pitch units
+// from middle C. compiled from a scala tuning (scala.hpp) before the patch is
+// published, so note on is a lookup.
+struct key_table {
+    static constexpr int unmapped = INT_MIN; // the key plays nothing
+
+    int pitch[128];
+
+    // a key as played on a patch transposed to middle_c
+    int lookup(int key, int middle_c) const {
+        key += 60 - middle_c;
+        return key >= 0 && key < 128 ? pitch[key] : unmapped;
+    }
+};
+typedef std::shared_ptr<key_table const> key_table_ptr;
+
+// unison: each note plays as up to this many copies, sharing its note on and
+// envelopes, each detuned and panned across the patch's spread and width
+const int max_unison = 4;
+
 struct patch {
     int feedback;
     bool mono;
@@ -154,30 +203,203 @@ struct patch {
     int tuning;
     int expr1;
     int expr2;
+    int unison;     // copies of each note [1, max_unison], or 0 for 1
+    int spread;     // detune from the lowest copy to the highest, pitch units
+    int width;      // pan of the outer copies either side of centre [0, 128]
 
     op_ptr ops[8];
     env_patch_ptr pitch_env;
     lfo_patch_ptr lfo;
+    key_table_ptr keys; // or nullptr for 12 tone equal temperament
 };
 typedef ptr_msg<patch> patch_ptr;
 
-// global state
-struct globals {
-    tables t;
+// free running lfo output, stepped once per control tick by the engine on
+// behalf of every voice when the patch does not resync the lfo per voice.
+struct lfo_output {
+    bool shared;    // voices use osc and neg instead of their own oscillator
+    bool flat;      // the envelope is constant; voices use out as is
+    int osc;
+    bool neg;
+    int out;
+};
 
+// a smoothed controller moves toward its input one unit per sample: where it
+// is after that many samples
+inline int
+smooth(int value, int target, uint64_t samples) {
+    int const move = (int)std::min(samples, (uint64_t)std::abs(target - value));
+    return value < target ? value + move : value - move;
+}
+
+// parameters a part takes from automation at the sample they arrive, in
+// place of the patch's own value and without publishing a new patch
+enum param_id {
+    param_feedback = 0,                     // the patch's feedback
+    param_lfo_frequency,                    // pitch units
+    param_op_level,                         // + op, as tables::level_param()
+    param_op_rate = param_op_level + 8,     // + op, faster by, on every stage entered
+    param_count = param_op_rate + 8
+};
+
+// one automated parameter, moving in a straight line to its target
+struct automation {
+    bool set;       // otherwise the patch's own value is used
+    int value;
+    int target;
+    int remaining;  // samples until value reaches target
+
+    // where it is after that many samples
+    void ramp(uint64_t samples) {
+        if (samples >= (uint64_t)remaining) {
+            value = target;
+            remaining = 0;
+        } else {
+            value += (int)((int64_t)(target - value) * (int64_t)samples / remaining);
+            remaining -= (int)samples;
+        }
+    }
+};
+
+// the patches a part's voices still play, reported by the engine at each
+// block boundary for patch_publisher: the part's current patch and any older
+// ones still sounding. a seqlock, as the producer reads it on its own thread.
+class held_patches {
+    public:
+        static const int max = 16;
+
+        held_patches() : _serial(0), _count(0) {
+            for (auto &h : _held) {
+                h.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        // engine: count -1 for more than max
+        void store(patch const *const *held, int count) {
+            unsigned const serial = _serial.load(std::memory_order_relaxed) + 1;
+            _serial.store(serial, std::memory_order_relaxed); // odd while writing
+            std::atomic_thread_fence(std::memory_order_release);
+            for (int i = 0; i < count; ++i) {
+                _held[i].store(held[i], std::memory_order_relaxed);
+            }
+            _count.store(count, std::memory_order_relaxed);
+            _serial.store(serial + 1, std::memory_order_release);
+        }
+
+        // producer: false if caught while written or too many to report
+        bool load(patch const **held, int *count) const {
+            unsigned const serial = _serial.load(std::memory_order_acquire);
+            if ((serial & 1) != 0) {
+                return false;
+            }
+            int const n = _count.load(std::memory_order_relaxed);
+            for (int i = 0; i < n && i < max; ++i) {
+                held[i] = _held[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            *count = n;
+            return n >= 0 && n <= max && _serial.load(std::memory_order_relaxed) == serial;
+        }
+
+    private:
+        std::atomic<unsigned> _serial;
+        std::atomic<int> _count;
+        std::atomic<patch const *> _held[max];
+};
+
+// running state for one midi channel's worth of patch (one part).
+// single timbral mode uses only the first part for every channel.
+struct part {
     // patch info
     patch_ptr patch;
 
-    // returned engine state
-    struct status *status;
+    // bumped by the producer after each patch.set(), including setting the
+    // same patch again after changing its algorithm
+    std::atomic<unsigned> generation;
+
+    // patches any voice still plays, from the engine
+    held_patches held;
+
+    // shared lfo
+    lfo_output lfo;
 
     // running info
     int mod_wheel;
     int pitch_bend;
     bool sustain_pedal;
 
+    // automation, see engine::param()
+    automation params[param_count];
+    bool automated; // any of params set
+
+    int param(int id, int value) const {
+        return params[id].set ? params[id].value : value;
+    }
+};
+
+const int max_parts = 16;
+
+// producer side of a part's patch. voices keep playing the patch they started
+// with after a new one is published, so a published patch is held here while
+// the engine may still play it. the final release of a patch then never
+// happens on the audio thread.
+class patch_publisher {
+    public:
+        void publish(part *part, patch_ptr::pointer const &patch) {
+            unsigned const generation = part->generation.load(std::memory_order_relaxed) + 1;
+            _history.push_back(patch);
+            part->patch.set(patch);
+            part->generation.store(generation, std::memory_order_release);
+
+            // keep the new patch, those the engine reported, and the one it
+            // took since, which it may have started voices on before reporting.
+            // patches published in between it never took are dropped.
+            ::patch const *held[held_patches::max];
+            int count;
+            if (!part->held.load(held, &count)) {
+                return;
+            }
+            ::patch const *used = part->patch.used();
+            auto const done = [&](patch_ptr::pointer const &p) {
+                return p.get() != used && std::find(held, held + count, p.get()) == held + count;
+            };
+            _history.erase(std::remove_if(_history.begin(), _history.end() - 1, done), _history.end() - 1);
+        }
+
+    private:
+        std::deque< patch_ptr::pointer > _history;
+};
+
+// global state
+struct globals {
+    globals(tables const &t) : t(t), multi(false), eg_mask(0), control_shift(0) {}
+
+    // shared by any number of engine instances at the same sample rate
+    tables const &t;
+
+    // per channel parts
+    part parts[max_parts];
+
+    // each midi channel plays its own part's patch
+    bool multi;
+
     // eg rate divider mask
     unsigned eg_mask;
+
+    // op envelopes step 1 << shift times less often, as many times as far,
+    // while the engine sheds load
+    int control_shift;
 };
 
+// envelopes and lfos step at a sample rate between 44.1k and 88.2k
+inline unsigned
+eg_rate_mask(double sampleRate) {
+    if (sampleRate >= 176400.0) {
+        return 0x3;
+    } else if (sampleRate >= 88200.0) {
+        return 0x1;
+    }
+    return 0x0;
+}
+
 #endif /* globals_h */
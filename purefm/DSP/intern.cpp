@@ -0,0 +1,162 @@
+//
+//  intern.cpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#include "intern.hpp"
+#include "cache.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <typeinfo>
+#include <unordered_map>
+
+// MARK: equality
+
+// the same fields patch_hash() takes, compared instead, for the rare hashes
+// which collide
+static bool
+same_env(env_patch const *a, env_patch const *b) {
+    if (a == b) {
+        return true;
+    }
+    if (a == nullptr || b == nullptr) {
+        return false;
+    }
+    if (a->loop != b->loop || a->expr != b->expr || a->after != b->after ||
+        a->lfo != b->lfo || a->bend != b->bend || a->scale != b->scale ||
+        a->key_up != b->key_up) {
+        return false;
+    }
+
+    auto const *x = a->egs.get();
+    auto const *y = b->egs.get();
+    if (x == y) {
+        return true;
+    }
+    if (x == nullptr || y == nullptr || x->size() != y->size()) {
+        return false;
+    }
+    for (size_t i = 0; i < x->size(); ++i) {
+        auto const &e = *(*x)[i];
+        auto const &f = *(*y)[i];
+        if (e.type != f.type || e.goal != f.goal || e.rate != f.rate) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool
+same_op(op_patch const *a, op_patch const *b) {
+    if (a == b) {
+        return true;
+    }
+    if (a == nullptr || b == nullptr) {
+        return false;
+    }
+    return a->mod == b->mod && a->sum == b->sum && a->enabled == b->enabled &&
+        a->level == b->level && a->resync == b->resync && a->velocity == b->velocity &&
+        a->rate_scale == b->rate_scale && a->breakpoint == b->breakpoint &&
+        a->key_scale_left == b->key_scale_left && a->key_scale_right == b->key_scale_right &&
+        a->scale_type_left == b->scale_type_left && a->scale_type_right == b->scale_type_right &&
+        a->frequency == b->frequency && a->fixed == b->fixed && a->feedback == b->feedback &&
+        a->wave == b->wave &&
+        same_env(a->env.get(), b->env.get());
+}
+
+static bool
+same_lfo(lfo_patch const *a, lfo_patch const *b) {
+    if (a == b) {
+        return true;
+    }
+    if (a == nullptr || b == nullptr) {
+        return false;
+    }
+    if (a->frequency != b->frequency || a->resync != b->resync) {
+        return false;
+    }
+    auto const *x = a->wave.get();
+    auto const *y = b->wave.get();
+    if ((x == nullptr) != (y == nullptr) || (x != nullptr && typeid(*x) != typeid(*y))) {
+        return false;
+    }
+    return same_env(a->env.get(), b->env.get());
+}
+
+static bool
+same(patch const *a, patch const *b) {
+    if (a->feedback != b->feedback || a->mono != b->mono || a->middle_c != b->middle_c ||
+        a->portamento != b->portamento || a->tuning != b->tuning ||
+        a->expr1 != b->expr1 || a->expr2 != b->expr2 ||
+        a->unison != b->unison || a->spread != b->spread || a->width != b->width) {
+        return false;
+    }
+
+    auto const *x = a->keys.get();
+    auto const *y = b->keys.get();
+    if ((x == nullptr) != (y == nullptr) ||
+        (x != nullptr && x != y && !std::equal(x->pitch, x->pitch + 128, y->pitch))) {
+        return false;
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        if (!same_op(a->ops[i].get(), b->ops[i].get())) {
+            return false;
+        }
+    }
+    return same_env(a->pitch_env.get(), b->pitch_env.get()) &&
+        same_lfo(a->lfo.get(), b->lfo.get());
+}
+
+// MARK: table
+
+static std::mutex table_lock;
+static std::unordered_multimap< uint64_t, std::weak_ptr<patch> > patches;
+static size_t swept = 0; // entries left by the last sweep
+
+// drop the entries of patches released since
+static void
+sweep() {
+    for (auto i = patches.begin(); i != patches.end(); ) {
+        if (i->second.expired()) {
+            i = patches.erase(i);
+        } else {
+            ++i;
+        }
+    }
+    swept = patches.size();
+}
+
+patch_ptr::pointer
+intern_patch(patch_ptr::pointer const &p) {
+    if (p == nullptr) {
+        return p;
+    }
+    uint64_t const h = patch_hash(p.get());
+
+    std::lock_guard<std::mutex> hold(table_lock);
+    auto const range = patches.equal_range(h);
+    for (auto i = range.first; i != range.second; ++i) {
+        auto found = i->second.lock();
+        if (found != nullptr && (found == p || same(found.get(), p.get()))) {
+            return found;
+        }
+    }
+
+    if (patches.size() >= 2 * swept + 64) {
+        sweep();
+    }
+    patches.emplace(h, p);
+    return p;
+}
+
+size_t
+interned_patches() {
+    std::lock_guard<std::mutex> hold(table_lock);
+    sweep();
+    return patches.size();
+}
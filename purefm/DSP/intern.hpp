@@ -0,0 +1,30 @@
+//
+//  intern.hpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#ifndef intern_hpp
+#define intern_hpp
+
+#include "globals.hpp"
+
+#include <cstddef>
+
+// process wide table of finished patches by content (patch_hash()), so any
+// number of engines, workers or banks holding the same patch share one copy.
+//
+// interning takes every part of the patch through ptr_msg::get(), after
+// which it is only ever read: an interned patch must not be changed again,
+// nor its messages set. the table only holds weak references; a patch goes
+// away with its last user as it otherwise would.
+
+// the interned patch equal to this one, or this one, now interned
+patch_ptr::pointer intern_patch(patch_ptr::pointer const &);
+
+// patches interned and still in use
+size_t interned_patches();
+
+#endif /* intern_hpp */
@@ -9,9 +9,14 @@
 #include "lfosc.hpp"
 #include "globals.hpp"
 
-lfo::lfo(globals const *g) : _env(g), _osc(g->t) {
+#include <algorithm>
+
+lfo::lfo(globals const *g, part const *const &part) :
+    _part(part), _osc(g->t), _env(g, part) {
     _globals = g;
     _patch = nullptr;
+    _frequency = 0;
+    _level = eg_min;
 }
 
 lfo::~lfo() {
@@ -33,10 +38,10 @@ lfo::start(lfo_patch const *patch, int velocity) {
 }
 
 void
-lfo::update(lfo_patch const *patch) {
+lfo::update(lfo_patch const *patch, bool reset) {
     _patch = patch;
     if (patch != nullptr) {
-        _env.update(patch->env.get(), true);
+        _env.update(patch->env.get(), reset);
     } else {
         _env.update(nullptr, true);
     }
@@ -56,10 +61,73 @@ lfo::step() {
         return 0;
     }
 
-    unsigned long pitch = _globals->t.pitch(_frequency);
-    osc = _osc.step(*f, pitch, 0, &neg);
+    auto const &shared = _part->lfo;
+    if (shared.flat) {
+        return shared.out;
+    }
+
+    if (shared.shared) {
+        osc = shared.osc;
+        neg = shared.neg;
+    } else {
+        unsigned long pitch = _globals->t.pitch(_part->param(param_lfo_frequency, _frequency));
+        osc = _osc.step(*f, pitch, 0, &neg);
+    }
     env = _env.step(1, 0);
 
     osc = _globals->t.output(osc, env);
     return neg ? -osc : osc;
 }
+
+bool
+lfo::flat(env_patch const *env, int *level) {
+    if (env == nullptr || env->key_up == 0) {
+        // a key up at stage 0 never starts
+        return false;
+    }
+    auto const *egs = env->egs.get();
+    if (egs == nullptr || egs->empty()) {
+        return false;
+    }
+
+    // delay stages output their goal immediately; all of the same goal
+    // hold that level from note on through key up and any loop.
+    // (voices start the lfo envelope at a level adjustment of eg_max)
+    int const goal = std::min(egs->front()->goal + eg_max, eg_max);
+    for (auto const &eg : *egs) {
+        if (eg->type != eg_delay ||
+            std::min(eg->goal + eg_max, eg_max) != goal) {
+            return false;
+        }
+    }
+
+    *level = goal;
+    return true;
+}
+
+void
+lfo::share(lfo_patch const *patch, lfo_output *out) {
+    _patch = patch;
+    out->shared = (patch != nullptr && !patch->resync);
+    out->flat = out->shared && flat(patch->env.get(), &_level);
+}
+
+void
+lfo::step(lfo_output *out) {
+    if (!out->shared) {
+        return;
+    }
+
+    auto const &&f = _patch->wave.get();
+    if (f == nullptr) {
+        out->out = 0;
+        return;
+    }
+
+    unsigned long pitch = _globals->t.pitch(_part->param(param_lfo_frequency, _patch->frequency));
+    out->osc = _osc.step(*f, pitch, 0, &out->neg);
+    if (out->flat) {
+        int const osc = _globals->t.output(out->osc, _level);
+        out->out = out->neg ? -osc : osc;
+    }
+}
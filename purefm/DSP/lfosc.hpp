@@ -15,20 +15,40 @@
 
 class lfo {
     public:
-        lfo(globals const *);
-        virtual ~lfo();
+        lfo(globals const *, part const *const &);
+        ~lfo();
 
         void start(lfo_patch const *patch, int velocity);
         int step();
-        void update(lfo_patch const *patch);
-        eg_status const *get_status() const { return _env.get_status(); }
+        void update(lfo_patch const *patch, bool reset = true);
+        eg_status get_status() const { return _env.get_status(0); }
+
+        // engine side of a shared lfo: configure out from the patch,
+        // then step once per control tick for all voices.
+        void share(lfo_patch const *patch, lfo_output *out);
+        void step(lfo_output *out);
+
+        void settle() { _env.settle(); }
+
+        template<class Archive>
+        void serialize(Archive &a) {
+            _osc.serialize(a);
+            _env.serialize(a);
+            a(_frequency);
+            a(_level);
+        }
+
+        // an envelope which outputs a single level from note on
+        static bool flat(env_patch const *env, int *level);
 
     private:
         globals const *_globals;
+        part const *const &_part;
         lfo_patch const *_patch;
         oscillator _osc;
         envelope _env;
         int _frequency;
+        int _level; // flat envelope level when shared
 };
 
 #endif /* lfosc_hpp */
@@ -0,0 +1,565 @@
+//
+//  library.cpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#include "library.hpp"
+#include "oscillator.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// file layout, all 32 bit fields unless noted, in the byte order of the host
+// which wrote it: records are read in place from the mapping, so a file from
+// a host of the other byte order is rejected (library_header::order) rather
+// than converted.
+//  header
+//  records[count]
+//  buckets[buckets]    name index, a power of 2 in size
+//  stages[stages]      envelope stages referenced by records
+//  names               utf8, not terminated
+
+static char const magic[8] = { 'p', 'u', 'r', 'e', 'f', 'm', 'l', 'b' };
+static uint32_t const byte_order = 0x01020304;
+
+struct library_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t order;     // byte_order as the writing host stores it
+    uint32_t count;
+    uint32_t buckets;
+    uint32_t stages;
+    uint64_t records_offset;
+    uint64_t buckets_offset;
+    uint64_t stages_offset;
+    uint64_t names_offset;
+    uint64_t length;
+};
+
+struct library_stage {
+    int32_t type;
+    int32_t goal;
+    int32_t rate;
+};
+
+struct library_env {
+    int32_t present;
+    int32_t loop;
+    int32_t expr;
+    int32_t after;
+    int32_t lfo;
+    int32_t bend;
+    int32_t scale;
+    int32_t key_up;
+    uint32_t first;     // index into stages
+    uint32_t count;
+};
+
+struct library_op {
+    int32_t present;
+    int32_t mod;
+    int32_t sum;
+    int32_t enabled;
+    int32_t level;
+    int32_t resync;
+    int32_t velocity;
+    int32_t rate_scale;
+    int32_t breakpoint;
+    int32_t key_scale_left;
+    int32_t key_scale_right;
+    int32_t scale_type_left;
+    int32_t scale_type_right;
+    int32_t frequency;
+    int32_t fixed;
+    int32_t feedback;
+    int32_t wave;
+    library_env env;
+};
+
+struct library_record {
+    uint64_t hash;      // of the record with the name fields zeroed
+    uint32_t name;      // offset into names
+    uint32_t name_length;
+
+    int32_t feedback;
+    int32_t mono;
+    int32_t middle_c;
+    int32_t portamento;
+    int32_t tuning;
+    int32_t expr1;
+    int32_t expr2;
+    int32_t unison;
+    int32_t spread;
+    int32_t width;
+
+    library_op ops[8];
+    library_env pitch_env;
+
+    int32_t lfo_present;
+    int32_t lfo_frequency;
+    int32_t lfo_resync;
+    int32_t lfo_wave;
+    library_env lfo_env;
+};
+
+struct library_bucket {
+    uint64_t hash;      // of the name
+    uint32_t record;    // empty if no_record
+    uint32_t pad;
+};
+
+static uint32_t const no_record = 0xffffffff;
+
+typedef enum {
+    wave_none = 0,
+    wave_sine,
+    wave_triangle,
+    wave_square,
+    wave_sawup,
+    wave_sawdown,
+    wave_noise
+} wave_type;
+
+static uint64_t
+fnv(uint64_t h, void const *data, size_t length) {
+    auto const *p = static_cast<uint8_t const *>(data);
+    for (size_t i = 0; i < length; ++i) {
+        h = (h ^ p[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint64_t
+fnv(void const *data, size_t length) {
+    return fnv(14695981039346656037ULL, data, length);
+}
+
+// MARK: reading
+
+library::library() {
+    _map = nullptr;
+    _length = 0;
+    _count = 0;
+    _buckets = 0;
+    _header = nullptr;
+}
+
+library::~library() {
+    close();
+}
+
+bool
+library::open(char const *path) {
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(library_header)) {
+        map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd); // the mapping holds its own reference
+
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    size_t const length = (size_t)st.st_size;
+    auto const *h = static_cast<library_header const *>(map);
+    bool valid =
+        std::memcmp(h->magic, magic, sizeof(magic)) == 0 &&
+        h->version == version &&
+        h->order == byte_order &&
+        h->length == length &&
+        (h->buckets & (h->buckets - 1)) == 0 &&
+        h->buckets > h->count &&
+        h->records_offset + (uint64_t)h->count * sizeof(library_record) <= length &&
+        h->buckets_offset + (uint64_t)h->buckets * sizeof(library_bucket) <= length &&
+        h->stages_offset + (uint64_t)h->stages * sizeof(library_stage) <= length &&
+        h->names_offset <= length;
+
+    if (!valid) {
+        munmap(map, length);
+        return false;
+    }
+
+    _map = map;
+    _length = length;
+    _header = h;
+    _count = (int)h->count;
+    _buckets = h->buckets;
+    return true;
+}
+
+void
+library::close() {
+    if (_map != nullptr) {
+        munmap(_map, _length);
+    }
+    _map = nullptr;
+    _length = 0;
+    _count = 0;
+    _buckets = 0;
+    _header = nullptr;
+}
+
+library_record const *
+library::at(int index) const {
+    auto const *base = static_cast<uint8_t const *>(_map);
+    return reinterpret_cast<library_record const *>(base + _header->records_offset) + index;
+}
+
+int
+library::find(std::string const &name) const {
+    if (_map == nullptr) {
+        return -1;
+    }
+
+    auto const *base = static_cast<uint8_t const *>(_map);
+    auto const *buckets = reinterpret_cast<library_bucket const *>(base + _header->buckets_offset);
+    uint64_t const h = fnv(name.data(), name.size());
+
+    // linear probe; there is always at least one empty bucket
+    for (uint32_t i = (uint32_t)h & (_buckets - 1); ; i = (i + 1) & (_buckets - 1)) {
+        auto const &b = buckets[i];
+        if (b.record == no_record) {
+            return -1;
+        }
+        if (b.hash == h && b.record < (uint32_t)_count && this->name((int)b.record) == name) {
+            return (int)b.record;
+        }
+    }
+}
+
+std::string
+library::name(int index) const {
+    auto const *r = at(index);
+    uint64_t const offset = _header->names_offset + r->name;
+    if (offset + r->name_length > _length) {
+        return std::string();
+    }
+    return std::string(static_cast<char const *>(_map) + offset, r->name_length);
+}
+
+uint64_t
+library::hash(int index) const {
+    return at(index)->hash;
+}
+
+static env_patch_ptr::pointer
+load_env(library_env const &e, library_stage const *stages, uint32_t count) {
+    if (!e.present) {
+        return nullptr;
+    }
+
+    auto egs = std::make_shared<eg_vec>();
+    if (e.first <= count && e.count <= count - e.first) {
+        egs->reserve(e.count);
+        for (uint32_t i = 0; i < e.count; ++i) {
+            auto const &s = stages[e.first + i];
+            auto stage = std::make_shared<eg>();
+            stage->type = (eg_type)s.type;
+            stage->goal = s.goal;
+            stage->rate = s.rate;
+            egs->push_back(stage);
+        }
+    }
+
+    auto p = std::make_shared<env_patch>();
+    p->loop = e.loop != 0;
+    p->expr = e.expr;
+    p->after = e.after;
+    p->lfo = e.lfo;
+    p->bend = e.bend;
+    p->scale = e.scale;
+    p->key_up = e.key_up;
+    p->egs.set(egs);
+    return p;
+}
+
+static function_ptr::pointer
+load_wave(int32_t wave) {
+    switch (wave) {
+    case wave_sine:
+        return std::make_shared<sine>();
+    case wave_triangle:
+        return std::make_shared<triangle>();
+    case wave_square:
+        return std::make_shared<square>();
+    case wave_sawup:
+        return std::make_shared<sawup>();
+    case wave_sawdown:
+        return std::make_shared<sawdown>();
+    case wave_noise:
+        return std::make_shared<noise>();
+    }
+    return nullptr;
+}
+
+patch_ptr::pointer
+library::load(int index) const {
+    if (_map == nullptr || index < 0 || index >= _count) {
+        return nullptr;
+    }
+
+    auto const *r = at(index);
+    auto const *base = static_cast<uint8_t const *>(_map);
+    auto const *stages = reinterpret_cast<library_stage const *>(base + _header->stages_offset);
+    uint32_t const count = _header->stages;
+
+    auto p = std::make_shared<patch>();
+    p->feedback = r->feedback;
+    p->mono = r->mono != 0;
+    p->middle_c = r->middle_c;
+    p->portamento = r->portamento;
+    p->tuning = r->tuning;
+    p->expr1 = r->expr1;
+    p->expr2 = r->expr2;
+    p->unison = r->unison;
+    p->spread = r->spread;
+    p->width = r->width;
+
+    for (int i = 0; i < 8; ++i) {
+        auto const &o = r->ops[i];
+        if (!o.present) {
+            continue;
+        }
+        auto op = std::make_shared<op_patch>();
+        op->mod = o.mod;
+        op->sum = o.sum;
+        op->enabled = o.enabled != 0;
+        op->level = o.level;
+        op->resync = o.resync != 0;
+        op->velocity = o.velocity;
+        op->rate_scale = o.rate_scale;
+        op->breakpoint = o.breakpoint;
+        op->key_scale_left = o.key_scale_left;
+        op->key_scale_right = o.key_scale_right;
+        op->scale_type_left = o.scale_type_left;
+        op->scale_type_right = o.scale_type_right;
+        op->frequency = o.frequency;
+        op->fixed = o.fixed != 0;
+        op->feedback = o.feedback;
+        op->wave = o.wave;
+        op->env.set(load_env(o.env, stages, count));
+        p->ops[i] = op;
+    }
+
+    p->pitch_env.set(load_env(r->pitch_env, stages, count));
+
+    if (r->lfo_present) {
+        auto l = std::make_shared<lfo_patch>();
+        l->frequency = r->lfo_frequency;
+        l->resync = r->lfo_resync != 0;
+        l->wave.set(load_wave(r->lfo_wave));
+        l->env.set(load_env(r->lfo_env, stages, count));
+        p->lfo.set(l);
+    }
+
+    return p;
+}
+
+// MARK: writing
+
+static void
+store_env(library_env *e, env_patch const *patch, std::vector<library_stage> *stages) {
+    std::memset(e, 0, sizeof(*e));
+    if (patch == nullptr) {
+        return;
+    }
+
+    e->present = 1;
+    e->loop = patch->loop;
+    e->expr = patch->expr;
+    e->after = patch->after;
+    e->lfo = patch->lfo;
+    e->bend = patch->bend;
+    e->scale = patch->scale;
+    e->key_up = patch->key_up;
+    e->first = (uint32_t)stages->size();
+
+    auto const *egs = patch->egs.get();
+    if (egs != nullptr) {
+        for (auto const &s : *egs) {
+            stages->push_back(library_stage{ (int32_t)s->type, s->goal, s->rate });
+        }
+    }
+    e->count = (uint32_t)stages->size() - e->first;
+}
+
+static int32_t
+store_wave(function const *f) {
+    if (f == nullptr) {
+        return wave_none;
+    }
+    // sawdown derives from sawup
+    if (dynamic_cast<sawdown const *>(f) != nullptr) {
+        return wave_sawdown;
+    }
+    if (dynamic_cast<sawup const *>(f) != nullptr) {
+        return wave_sawup;
+    }
+    if (dynamic_cast<triangle const *>(f) != nullptr) {
+        return wave_triangle;
+    }
+    if (dynamic_cast<square const *>(f) != nullptr) {
+        return wave_square;
+    }
+    if (dynamic_cast<noise const *>(f) != nullptr) {
+        return wave_noise;
+    }
+    return wave_sine;
+}
+
+static void
+store_patch(library_record *r, patch const *p, std::vector<library_stage> *stages) {
+    std::memset(r, 0, sizeof(*r));
+    r->feedback = p->feedback;
+    r->mono = p->mono;
+    r->middle_c = p->middle_c;
+    r->portamento = p->portamento;
+    r->tuning = p->tuning;
+    r->expr1 = p->expr1;
+    r->expr2 = p->expr2;
+    r->unison = p->unison;
+    r->spread = p->spread;
+    r->width = p->width;
+
+    for (int i = 0; i < 8; ++i) {
+        auto &o = r->ops[i];
+        auto const *op = p->ops[i].get();
+        if (op == nullptr) {
+            continue;
+        }
+        o.present = 1;
+        o.mod = op->mod;
+        o.sum = op->sum;
+        o.enabled = op->enabled;
+        o.level = op->level;
+        o.resync = op->resync;
+        o.velocity = op->velocity;
+        o.rate_scale = op->rate_scale;
+        o.breakpoint = op->breakpoint;
+        o.key_scale_left = op->key_scale_left;
+        o.key_scale_right = op->key_scale_right;
+        o.scale_type_left = op->scale_type_left;
+        o.scale_type_right = op->scale_type_right;
+        o.frequency = op->frequency;
+        o.fixed = op->fixed;
+        o.feedback = op->feedback;
+        o.wave = op->wave;
+        store_env(&o.env, op->env.get(), stages);
+    }
+
+    store_env(&r->pitch_env, p->pitch_env.get(), stages);
+
+    auto const *l = p->lfo.get();
+    if (l != nullptr) {
+        r->lfo_present = 1;
+        r->lfo_frequency = l->frequency;
+        r->lfo_resync = l->resync;
+        r->lfo_wave = store_wave(l->wave.get());
+        store_env(&r->lfo_env, l->env.get(), stages);
+    } else {
+        store_env(&r->lfo_env, nullptr, stages);
+    }
+}
+
+// the content hash covers the stages by value rather than their position
+static uint64_t
+record_hash(library_record const &r, std::vector<library_stage> const &stages) {
+    library_record c = r;
+    c.hash = 0;
+    c.name = 0;
+    c.name_length = 0;
+
+    uint64_t h = 14695981039346656037ULL;
+    auto env = [&](library_env &e) {
+        if (e.count != 0) {
+            h = fnv(h, &stages[e.first], e.count * sizeof(library_stage));
+        }
+        e.first = 0;
+    };
+    for (auto &o : c.ops) {
+        env(o.env);
+    }
+    env(c.pitch_env);
+    env(c.lfo_env);
+
+    return fnv(h, &c, sizeof(c));
+}
+
+bool
+library::write(char const *path, std::vector<library_entry> const &entries) {
+    std::vector<library_record> records(entries.size());
+    std::vector<library_stage> stages;
+    std::string names;
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        auto &r = records[i];
+        auto const &e = entries[i];
+        if (e.patch == nullptr) {
+            return false;
+        }
+        store_patch(&r, e.patch.get(), &stages);
+        r.hash = record_hash(r, stages);
+        r.name = (uint32_t)names.size();
+        r.name_length = (uint32_t)e.name.size();
+        names += e.name;
+    }
+
+    // at most half full
+    uint32_t buckets = 16;
+    while (buckets < records.size() * 2) {
+        buckets <<= 1;
+    }
+    std::vector<library_bucket> index(buckets, library_bucket{ 0, no_record, 0 });
+    for (size_t i = 0; i < entries.size(); ++i) {
+        uint64_t const h = fnv(entries[i].name.data(), entries[i].name.size());
+        uint32_t b = (uint32_t)h & (buckets - 1);
+        while (index[b].record != no_record) {
+            b = (b + 1) & (buckets - 1);
+        }
+        index[b].hash = h;
+        index[b].record = (uint32_t)i;
+    }
+
+    library_header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, magic, sizeof(magic));
+    h.version = version;
+    h.order = byte_order;
+    h.count = (uint32_t)records.size();
+    h.buckets = buckets;
+    h.stages = (uint32_t)stages.size();
+    h.records_offset = sizeof(h);
+    h.buckets_offset = h.records_offset + records.size() * sizeof(library_record);
+    h.stages_offset = h.buckets_offset + index.size() * sizeof(library_bucket);
+    h.names_offset = h.stages_offset + stages.size() * sizeof(library_stage);
+    h.length = h.names_offset + names.size();
+
+    FILE *f = std::fopen(path, "wb");
+    if (f == nullptr) {
+        return false;
+    }
+    std::fwrite(&h, sizeof(h), 1, f);
+    std::fwrite(records.data(), sizeof(library_record), records.size(), f);
+    std::fwrite(index.data(), sizeof(library_bucket), index.size(), f);
+    std::fwrite(stages.data(), sizeof(library_stage), stages.size(), f);
+    std::fwrite(names.data(), 1, names.size(), f);
+    bool const ok = std::ferror(f) == 0;
+    return (std::fclose(f) == 0) && ok;
+}
@@ -0,0 +1,71 @@
+//
+//  library.hpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#ifndef library_hpp
+#define library_hpp
+
+#include "globals.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// memory mapped patch library: flat compiled patch records with an open
+// addressing name index. opening maps the file and checks the header; the
+// records are read in place when a patch is loaded.
+
+struct library_header;
+struct library_record;
+
+struct library_entry {
+    std::string name;
+    patch_ptr::pointer patch;
+};
+
+class library {
+    public:
+        static constexpr uint32_t version = 5;
+
+        library();
+        virtual ~library();
+
+        // false if the file is missing, truncated, another version or from a
+        // host of the other byte order
+        bool open(char const *path);
+        void close();
+
+        int size() const { return _count; }
+
+        // index of the first patch with this name, or -1
+        int find(std::string const &name) const;
+
+        std::string name(int index) const;
+
+        // hash of the compiled patch, independent of its name
+        uint64_t hash(int index) const;
+
+        // a new engine patch from the record
+        patch_ptr::pointer load(int index) const;
+
+        // write entries to path. patches must not have been handed to an
+        // engine yet, as their parts are read with ptr_msg::get().
+        static bool write(char const *path, std::vector<library_entry> const &entries);
+
+    private:
+        library_record const *at(int index) const;
+
+    private:
+        void *_map;
+        size_t _length;
+        int _count;
+        uint32_t _buckets;
+        library_header const *_header;
+};
+
+#endif /* library_hpp */
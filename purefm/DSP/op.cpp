@@ -9,22 +9,49 @@
 #include "op.hpp"
 #include "globals.hpp"
 
+#include <algorithm>
 #include <cmath>
 
-op::op(globals const *g, int const &lfo, int const &pitch, int const &pressure)
-    : _osc(g->t), _env(g), _lfo(lfo), _pitch(pitch), _pressure(pressure) {
+static_assert(max_unison == 4, "op::_osc and op::_kernels are written out for 4 unison copies");
+
+op::op(globals const *g, part const *const &part,
+       int const &lfo, int const &pitch, int const &pressure,
+       int const &copies, int const *detune, int number)
+    : _part(part), _osc{g->t, g->t, g->t, g->t}, _env(g, part, param_op_rate + number),
+      _lfo(lfo), _pitch(pitch), _pressure(pressure), _copies(copies) {
     _globals = g;
+    _number = number;
+    _detune = detune;
     _patch = nullptr;
-    _sum = &_zero;
-    _mod = &_zero;
-    _out = 0;
+    _sum = _zero;
+    _mod = _zero;
+    std::fill_n(_out, max_unison, 0);
     _eg = 0;
     _fb = nullptr;
+    std::fill_n(_increment, max_unison, 0);
+    _count = 0;
+    _silent = false;
+    _render = &op::render<sine_wave, 1>;
 }
 
 op::~op() {
 }
 
+#define KERNELS(W) { &op::render<W, 1>, &op::render<W, 2>, &op::render<W, 3>, &op::render<W, 4> }
+
+op::kernel const op::_kernels[op_wave_count][max_unison] = {
+    KERNELS(sine_wave),
+    KERNELS(half_sine_wave),
+    KERNELS(abs_sine_wave),
+    KERNELS(pulse_sine_wave),
+    KERNELS(alt_sine_wave),
+    KERNELS(camel_sine_wave),
+    KERNELS(square_wave),
+    KERNELS(log_saw_wave),
+};
+
+#undef KERNELS
+
 void
 op::update(op_patch const *patch, bool reset) {
     _patch = patch;
@@ -51,25 +78,25 @@ key_scale(int value, int type) {
 void
 op::set_sum(op const *s) {
     if (s == nullptr) {
-        _sum = &_zero;
+        _sum = _zero;
     } else {
-        _sum = &s->_out;
+        _sum = s->_out;
     }
 }
 
 void
 op::set_mod(op const *s) {
     if (s == nullptr) {
-        _mod = &_zero;
+        _mod = _zero;
     } else {
-        _mod = &s->_out;
+        _mod = s->_out;
     }
 }
 
 void
 op::set_fb_input(fb_filter const *f) {
     if (f == nullptr) {
-        _mod = &_zero;
+        _mod = _zero;
     } else {
         _mod = f->output();
     }
@@ -92,6 +119,8 @@ op::start(op_patch const *patch, int key, int velocity) {
         return;
     }
 
+    env_patch const *env = patch->env.get();
+
     int level = _patch->level;
 
     if (key > _patch->breakpoint) {
@@ -111,52 +140,126 @@ op::start(op_patch const *patch, int key, int velocity) {
         level = eg_max;
     }
 
+    // at minimum level every stage goal clamps to eg_min, which output()
+    // shifts to exactly zero, unless something biases the envelope up.
+    // an envelope already at rest stays there for the whole note. (so does
+    // level automation arriving after note on.)
+    _silent = (level == eg_min && _env.idle() && env != nullptr &&
+               env->lfo == 0 && env->after >= 7 && env->expr >= 7 &&
+               !_part->params[param_op_level + _number].set);
+
     int r = (((key - 21) * _patch->rate_scale) / 192);
     if (r < 0) {
         r = 0;
     } else if (r > 64) {
         r = 64;
     }
-    _env.start(patch->env.get(), eg_min + level, r, true);
+    _env.start(env, eg_min + level, r, true);
 
     if (patch->resync) {
-        _osc.reset();
+        for (auto &o : _osc) {
+            o.reset();
+        }
     }
 }
 
-int
-op::step() {
-    if (_patch == nullptr) {
-        return 0;
+void
+op::settle(bool out) {
+    _eg = 0;
+    _count = 0;
+    for (auto &o : _osc) {
+        o.settle();
     }
-    if (!_patch->enabled || _env.idle()) {
-        _out = *_sum;
-        return _out;
+    _env.settle();
+    if (out) {
+        std::fill_n(_out, max_unison, 0);
+    }
+}
+
+// the envelope's bias, and the level as automated away from the patch's
+int
+op::bias() const {
+    int bias = _env.op_bias(_lfo, _pressure);
+    auto const &level = _part->params[param_op_level + _number];
+    if (level.set && _patch != nullptr) {
+        bias += level.value - _patch->level;
     }
+    return bias;
+}
+
+void
+op::group() {
+    // the model may change the wave in place, as it does the frequency
+    int const wave = _patch->wave;
+    _render = _kernels[wave >= 0 && wave < op_wave_count ? wave : op_wave_sine][_copies - 1];
 
     int frequency = _patch->frequency;
     if (!_patch->fixed) {
         frequency += _pitch;
     }
+    for (int k = 0; k < _copies; ++k) {
+        _increment[k] = _globals->t.pitch(frequency + _detune[k]);
+    }
+}
 
-    bool neg;
-    int mod = *_mod << 3;
-    int out = _osc.step(_globals->t.pitch(frequency), mod, &neg);
+void
+op::skip() {
+    group();
 
-    if ((++_count & _globals->eg_mask) == 0) {
-        int bias = _env.op_bias(_lfo, _pressure);
-        _eg = _env.step(1, bias);
+    // as render() steps until the op goes inactive
+    int const shift = _globals->control_shift;
+    int n = 0;
+    for (; n < 16 && active(); ++n) {
+        _count = (_count + 1) & ((_globals->eg_mask << shift) | ((1u << shift) - 1));
+        if (_count == 0) {
+            _eg = _env.step(1 << shift, bias());
+        }
     }
+    for (int k = 0; k < _copies; ++k) {
+        _osc[k].advance(_increment[k] * n);
+    }
+}
 
-    out = _globals->t.output(out, _eg);
-    out = (neg ? -out : out);
+template< class W, int N >
+void
+op::render() {
+    if (_patch == nullptr) {
+        return;
+    }
+    if (!active()) {
+        // an op passing its sum through skips group(), so has no kernel of
+        // its own for the note
+        std::copy_n(_sum, _copies, _out);
+        return;
+    }
 
-    // enter feedback loop _before_ summation
-    if (_fb != nullptr) {
-        _fb->input(out);
+    // only the phase against the eg rate counts, so none of the op's history
+    // is kept in its state
+    int const shift = _globals->control_shift;
+    _count = (_count + 1) & ((_globals->eg_mask << shift) | ((1u << shift) - 1));
+    if (_count == 0) {
+        _eg = _env.step(1 << shift, bias());
     }
 
-    _out = out + *_sum;
-    return _out;
+    // unison copies share the envelope; only their phases differ
+    for (int k = 0; k < N; ++k) {
+        bool neg;
+        int out = _osc[k].step<W>(_increment[k], _mod[k] << 3, &neg);
+
+        if (W::gaps && out == W::silent) {
+            // a gap in the wave, at any envelope level
+            out = 0;
+        } else {
+            out = _globals->t.output(out, _eg);
+            out = (neg ? -out : out);
+        }
+
+        // enter feedback loop _before_ summation
+        if (_fb != nullptr) {
+            _fb->input(k, out);
+        }
+
+        _out[k] = out + _sum[k];
+    }
 }
 
@@ -15,38 +15,61 @@
 
 #include <algorithm>
 
+// one feedback loop, side by side for each unison copy
 class fb_filter {
     public:
         fb_filter() {
-            std::fill_n(_buf, 4, 0);
+            for (auto &b : _buf) {
+                std::fill_n(b, max_unison, 0);
+            }
             _ptr = 0;
-            _acc = 0;
-            _in = 0;
-            _out = 0;
+            std::fill_n(_acc, max_unison, 0);
+            std::fill_n(_in, max_unison, 0);
+            std::fill_n(_out, max_unison, 0);
         }
-        virtual ~fb_filter() {}
+        ~fb_filter() {}
 
-        void input(int in) { _in = in; }
-        int const *output() const { return &_out; }
+        void input(int copy, int in) { _in[copy] = in; }
+        int const *output() const { return _out; }
 
-        void step(int scale) {
-            _acc += _in - _buf[_ptr];
-            _buf[_ptr] = _in;
+        void step(int scale, int copies) {
+            int *buf = _buf[_ptr];
+            for (int k = 0; k < copies; ++k) {
+                _acc[k] += _in[k] - buf[k];
+                buf[k] = _in[k];
+                _out[k] = (_acc[k] * scale) >> 10; // scale (by half at full) + /4 average
+            }
             _ptr = (_ptr + 1) & 3;
-            _out = (_acc * scale) >> 10; // scale (by half at full) + /4 average
+        }
+
+        template<class Archive>
+        void serialize(Archive &a, int copies) {
+            for (int k = 0; k < copies; ++k) {
+                a(_in[k]);
+                a(_out[k]);
+                for (auto &b : _buf) {
+                    a(b[k]);
+                }
+                a(_acc[k]);
+            }
+            a(_ptr);
+            _ptr &= 3;
         }
 
     private:
-        int _in, _out;
-        int _buf[4];
-        int _ptr, _acc;
+        int _in[max_unison], _out[max_unison];
+        int _buf[4][max_unison];
+        int _ptr, _acc[max_unison];
 };
 
 // from this level, all things are normalized to 24 bit ranges
 class op {
     public:
-        op(globals const *, int const &lfo, int const &pitch, int const &pressure);
-        virtual ~op();
+        // number is the op's place in the algorithm [0,7], for its automation.
+        // every unison copy steps at the pitch plus its detune.
+        op(globals const *, part const *const &, int const &lfo, int const &pitch, int const &pressure,
+           int const &copies, int const *detune, int number);
+        ~op();
 
         void set_sum(op const *s);
         void set_mod(op const *m);
@@ -55,24 +78,74 @@ class op {
 
         void start(op_patch const *patch, int key, int velocity);
         void update(op_patch const *patch, bool reset);
-        int step();
-        eg_status const *get_status() const { return _env.get_status(); }
+        void step() { (this->*_render)(); }
+
+        // per unison copy, after step()
+        int const *output() const { return _out; }
+
+        // before a group of 16 steps: the phase increment and waveform for
+        // all of them. the voice pitch only moves between groups.
+        void group();
+
+        // a group of 16 steps of an op whose output nothing reads this block:
+        // its envelope and phase move on as if it had rendered them.
+        void skip();
+
+        // producing output of its own, rather than passing its sum through
+        bool active() const {
+            return _patch != nullptr && _patch->enabled && !_silent && !_env.idle();
+        }
+        eg_status get_status() const { return _env.get_status(bias()); }
+
+        // clear values overwritten before they are next read when the
+        // envelope steps every sample; out too if no op reads it first.
+        void settle(bool out);
+
+        // of as many unison copies as the algo has
+        template<class Archive>
+        void serialize(Archive &a) {
+            for (int k = 0; k < _copies; ++k) {
+                a(_out[k]);
+                _osc[k].serialize(a);
+            }
+            a(_eg);
+            a(_count);
+            a(_silent);
+            _env.serialize(a);
+        }
+
+    private:
+        int bias() const;
+
+        // step() for the patch's waveform and unison copies, chosen by group()
+        template< class W, int N >
+        void render();
+        typedef void (op::*kernel)();
+        static kernel const _kernels[op_wave_count][max_unison];
 
     private:
         globals const *_globals;
+        part const *const &_part;
+        int _number;
         op_patch const *_patch;
         int const &_lfo;
         int const &_pitch;
         int const &_pressure;
+        int const &_copies;
+        int const *_detune;
         int const *_sum;
         int const *_mod;
         fb_filter *_fb;
-        int _out, _eg;
-        sine_oscillator _osc;
+        int _out[max_unison];
+        int _eg;
+        op_oscillator _osc[max_unison];
+        kernel _render;
+        long _increment[max_unison];
         envelope _env;
         unsigned _count;
+        bool _silent; // level pinned at eg_min for this note
 
-        int const _zero = 0;
+        static constexpr int _zero[max_unison] = {};
 };
 
 #endif /* op_hpp */
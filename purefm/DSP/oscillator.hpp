@@ -65,10 +65,16 @@ class noise : public function {
 class oscillator {
     public:
         oscillator(tables const &t);
-        virtual ~oscillator();
+        ~oscillator();
 
         void reset() { _phase = 0; }
 
+        template<class Archive>
+        void serialize(Archive &a) {
+            a(_phase);
+            a(_out);
+        }
+
         template< class T >
         int step(T const &f, long pitch, int offset, bool *neg) {
             long prev = (_phase & 0xffffffff);
@@ -91,24 +97,122 @@ class oscillator {
             return _out;
         }
 
-    private:
+    protected:
+        int _out;
         tables const &_tables;
         long _phase;
-        int _out;
 };
 
-// convenience sine oscillator for the operators
-class sine_oscillator : public oscillator {
+// MARK: op waveforms
+
+// each op waveform is the log value and sign at a phase over the whole period
+// [0, 0xffff], or silent in its gaps, for op::render<>() to inline.
+// the sine halves and quarters are all read from the same log sine table.
+struct sine_wave {
+    static constexpr bool gaps = false;
+    static constexpr int silent = -1;
+
+    // a positive half period [0, 0x7fff]
+    static int half(tables const &t, int phase) {
+        if ((phase & 0x4000) != 0) {
+            phase = (phase & 0x3fff) ^ 0x3fff;
+        }
+        return t.logsin(phase);
+    }
+
+    static int generate(tables const &t, int phase, bool *neg) {
+        *neg = (phase & 0x8000) != 0;
+        if (*neg) {
+            phase ^= 0x7fff;
+        }
+        return half(t, phase & 0x7fff);
+    }
+};
+
+struct half_sine_wave : sine_wave {
+    static constexpr bool gaps = true;
+
+    static int generate(tables const &t, int phase, bool *neg) {
+        *neg = false;
+        return (phase & 0x8000) != 0 ? silent : half(t, phase);
+    }
+};
+
+struct abs_sine_wave : sine_wave {
+    static int generate(tables const &t, int phase, bool *neg) {
+        *neg = false;
+        return half(t, phase & 0x7fff);
+    }
+};
+
+struct pulse_sine_wave : sine_wave {
+    static constexpr bool gaps = true;
+
+    static int generate(tables const &t, int phase, bool *neg) {
+        *neg = false;
+        return (phase & 0x4000) != 0 ? silent : t.logsin(phase & 0x3fff);
+    }
+};
+
+struct alt_sine_wave : sine_wave {
+    static constexpr bool gaps = true;
+
+    static int generate(tables const &t, int phase, bool *neg) {
+        if ((phase & 0x8000) != 0) {
+            *neg = false;
+            return silent;
+        }
+        return sine_wave::generate(t, (phase << 1) & 0xffff, neg);
+    }
+};
+
+struct camel_sine_wave : sine_wave {
+    static constexpr bool gaps = true;
+
+    static int generate(tables const &t, int phase, bool *neg) {
+        *neg = false;
+        return (phase & 0x8000) != 0 ? silent : half(t, (phase << 1) & 0x7fff);
+    }
+};
+
+struct square_wave : sine_wave {
+    static int generate(tables const &t, int phase, bool *neg) {
+        *neg = (phase & 0x8000) != 0;
+        return t.logsin(0x3fff);
+    }
+};
+
+// falls 16 octaves (96dB) over each half, at the sine's step of 1 << 14
+// per octave
+struct log_saw_wave : sine_wave {
+    static int generate(tables const &, int phase, bool *neg) {
+        *neg = (phase & 0x8000) != 0;
+        if (*neg) {
+            phase ^= 0x7fff;
+        }
+        return (phase & 0x7fff) << 3;
+    }
+};
+
+// the operators' oscillator, stepping whichever waveform its caller renders
+class op_oscillator : public oscillator {
     public:
-        sine_oscillator(tables const &t) : oscillator(t) {}
-        virtual ~sine_oscillator() {}
+        op_oscillator(tables const &t) : oscillator(t) {}
+        ~op_oscillator() {}
 
+        template< class W >
         int step(long pitch, int offset, bool *neg) {
-            return oscillator::step(_sine, pitch, offset, neg);
+            _phase += pitch;
+            long const phase = ((_phase & 0xffffffff) + (offset << 8)) >> 16;
+            _out = W::generate(_tables, (int)(phase & 0xffff), neg);
+            return _out;
         }
 
-    private:
-        sine _sine;
+        // the wave is generated every step; the last value is never read
+        void settle() { _out = 0; }
+
+        // the phase of steps not rendered, without their output
+        void advance(long pitch) { _phase += pitch; }
 };
 
 #endif /* oscillator_hpp */
@@ -13,9 +13,13 @@
 #import "tables.hpp"
 #import "engine.hpp"
 #import "globals.hpp"
+#import "telemetry.hpp"
+#import "trace.hpp"
 #import "status.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 
 /*
  purefmDSPKernel
@@ -25,33 +29,96 @@ public:
     
     // MARK: Member Functions
 
-    purefmDSPKernel() : _engine(&_globals) {
-        _status.voice = nullptr;
-        _globals.status = &_status;
+    purefmDSPKernel() : _globals(_tables), _engine(&_globals) {
     }
     virtual ~purefmDSPKernel() {}
 
     void init(int channelCount, double inSampleRate) {
         chanCount = channelCount;
         sampleRate = float(inSampleRate);
-        _globals.t.init(inSampleRate);
-
-        if (inSampleRate >= 176400.0) {
-            _globals.eg_mask = 0x3;
-        } else if (inSampleRate >= 88200.0) {
-            _globals.eg_mask = 0x1;
-        } else {
-            _globals.eg_mask = 0x0;
-        }
+        _tables.init(inSampleRate);
+        _globals.eg_mask = eg_rate_mask(inSampleRate);
+        _telemetry.set_rate(inSampleRate);
     }
 
     void setPatch(patch_ptr::pointer const &patch) {
-        _globals.patch.set(patch);
-        _engine.update();
+        setPatch(0, patch);
+    }
+
+    // patch for a midi channel's part; channel 0 is the only part unless multi timbral.
+    // the engine picks it up at the start of the next render block. channels
+    // past the last part are ignored.
+    void setPatch(int channel, patch_ptr::pointer const &patch) {
+        if (channel < 0 || channel >= max_parts) {
+            return;
+        }
+        _publishers[channel].publish(&_globals.parts[channel], patch);
+    }
+
+    // multi timbral: each midi channel plays its own patch from a shared
+    // pool of voices. not while rendering.
+    void setMulti(bool multi, int voices) {
+        _globals.multi = multi;
+        _engine.allocate(voices);
+    }
+
+    // an audio unit parameter the engine also applies itself, as a param_id,
+    // at the sample offset of its render events. not while rendering.
+    void automateParameter(AUParameterAddress address, int param) {
+        if (_automatedCount < param_count) {
+            auto &a = _automated[_automatedCount++];
+            a.address = address;
+            a.param = param;
+            a.dirty.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    // an automated parameter set outside of render, applied at the start of
+    // the next render block. any thread: the latest value of each parameter
+    // set since the last block wins.
+    void setParameter(AUParameterAddress address, AUValue value) {
+        for (int i = 0; i < _automatedCount; ++i) {
+            auto &a = _automated[i];
+            if (a.address == address) {
+                a.value.store(value, std::memory_order_relaxed);
+                a.dirty.store(true, std::memory_order_release);
+                return;
+            }
+        }
+    }
+
+    // status is only taken, once per render block, while a reader wants it
+    void setStatusEnabled(bool enabled) {
+        _status.enable(enabled);
+    }
+
+    // non-realtime reader of the last status taken
+    bool readStatus(struct status *status) const {
+        return _status.read(status);
+    }
+
+    // non-realtime reader of per render block counters
+    bool nextBlockStats(block_stats *stats) {
+        return _telemetry.pop(stats);
     }
 
-    struct status const *getStatus() const {
-        return &_status;
+    // one render block: events and audio, measured for telemetry
+    void render(AudioTimeStamp const *timestamp, AUAudioFrameCount frameCount, AURenderEvent const *events) {
+        TRACE_SCOPE("render block");
+        _telemetry.begin();
+        _engine.sync();
+        for (int i = 0; i < _automatedCount; ++i) {
+            auto &a = _automated[i];
+            if (a.dirty.exchange(false, std::memory_order_acquire)) {
+                apply(a.param, a.value.load(std::memory_order_relaxed), 0);
+            }
+        }
+        processWithEvents(timestamp, frameCount, events, nil /* MIDIOutEventBlock */);
+        if (_status.enabled()) {
+            _engine.get_status(_status.write());
+            _status.publish();
+        }
+        _telemetry.end(_engine, frameCount);
     }
 
     void reset() {
@@ -70,18 +137,43 @@ public:
         outBufferListPtr = outBufferList;
     }
 
+    // unison copies spread across the first two channels (mid - side and
+    // mid + side); mono, or any channel past those, has the mid alone.
     void process(AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset) override {
         float* out = (float*)outBufferListPtr->mBuffers[0].mData;
-
-        for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
-            const int frameOffset = int(frameIndex + bufferOffset);
-
-            out[frameOffset] = (float)_engine.step() / (float)0x8000000;
+        float* right = nullptr;
+        if (chanCount > 1) {
+            right = (float*)outBufferListPtr->mBuffers[1].mData;
         }
-        for (int channel = 1; channel < chanCount; ++channel) {
+        int buffer[64];
+        int side[64];
+
+        for (AUAudioFrameCount done = 0; done < frameCount; ) {
+            const int count = int(std::min(frameCount - done, AUAudioFrameCount(64)));
+            const int frameOffset = int(done + bufferOffset);
+
+            if (right != nullptr && right != out) {
+                _engine.render(buffer, side, count);
+                for (int frameIndex = 0; frameIndex < count; ++frameIndex) {
+                    const int mid = buffer[frameIndex];
+                    const int s = side[frameIndex];
+                    out[frameOffset + frameIndex] = (float)(mid - s) / (float)0x8000000;
+                    right[frameOffset + frameIndex] = (float)(mid + s) / (float)0x8000000;
+                }
+            } else {
+                _engine.render(buffer, count);
+                for (int frameIndex = 0; frameIndex < count; ++frameIndex) {
+                    out[frameOffset + frameIndex] = (float)buffer[frameIndex] / (float)0x8000000;
+                }
+            }
+            done += AUAudioFrameCount(count);
+        }
+        for (int channel = 2; channel < chanCount; ++channel) {
             float *out2 = (float *)outBufferListPtr->mBuffers[channel].mData;
-            if (out2 != out) {
-                std::copy_n(out+bufferOffset, frameCount, out2+bufferOffset);
+            if (out2 != out && out2 != right) {
+                for (AUAudioFrameCount i = bufferOffset; i < bufferOffset + frameCount; ++i) {
+                    out2[i] = right != nullptr ? (out[i] + right[i]) * 0.5f : out[i];
+                }
             }
         }
     }
@@ -90,17 +182,54 @@ public:
         _engine.midi(midiEvent.data);
     }
 
-    // MARK: Member Variables
+    // a ramp event moves from where the parameter is to its value
+    void handleParameterEvent(AUParameterEvent const& parameterEvent) override {
+        automate(parameterEvent.parameterAddress, parameterEvent.value,
+                 parameterEvent.rampDurationSampleFrames);
+    }
 
 private:
+    // the audio unit edits the first part's patch
+    void automate(AUParameterAddress address, AUValue value, AUAudioFrameCount ramp) {
+        for (int i = 0; i < _automatedCount; ++i) {
+            if (_automated[i].address == address) {
+                apply(_automated[i].param, value, ramp);
+                return;
+            }
+        }
+    }
+
+    void apply(int param, AUValue value, AUAudioFrameCount ramp) {
+        int v = int(std::lround(value));
+        if (param >= param_op_level && param < param_op_level + 8) {
+            v = tables::level_param(v);
+        }
+        _engine.param(0, param, v, int(ramp));
+    }
+
+    // MARK: Member Variables
+
+    // value and dirty are set from any thread outside of render
+    struct automated_parameter {
+        AUParameterAddress address;
+        int param;
+        std::atomic<AUValue> value;
+        std::atomic<bool> dirty;
+    };
+
     int chanCount = 0;
     float sampleRate = 44100.0;
     bool bypassed = false;
     AudioBufferList* inBufferListPtr = nullptr;
     AudioBufferList* outBufferListPtr = nullptr;
+    tables _tables;
     struct globals _globals;
-    struct status _status;
     class engine _engine;
+    patch_publisher _publishers[max_parts];
+    class telemetry _telemetry;
+    status_snapshot _status;
+    automated_parameter _automated[param_count];
+    int _automatedCount = 0;
 };
 
 #endif /* purefmDSPKernel_hpp */
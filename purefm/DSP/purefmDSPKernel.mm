@@ -35,8 +35,32 @@
     _kernel.setPatch(patch);
 }
 
-- (struct status const *)status {
-    return _kernel.getStatus();
+- (void)setPatch:(const patch_ptr::pointer &)patch forChannel:(int)channel {
+    _kernel.setPatch(channel, patch);
+}
+
+- (void)setMulti:(BOOL)multi voices:(int)voices {
+    _kernel.setMulti(multi, voices);
+}
+
+- (void)automateParameter:(AUParameterAddress)address as:(int)param {
+    _kernel.automateParameter(address, param);
+}
+
+- (void)setParameter:(AUParameterAddress)address value:(AUValue)value {
+    _kernel.setParameter(address, value);
+}
+
+- (void)setStatusEnabled:(BOOL)enabled {
+    _kernel.setStatusEnabled(enabled);
+}
+
+- (BOOL)readStatus:(struct status *)status {
+    return _kernel.readStatus(status) ? YES : NO;
+}
+
+- (BOOL)nextBlockStats:(struct block_stats *)stats {
+    return _kernel.nextBlockStats(stats) ? YES : NO;
 }
 
 - (AUAudioUnitBus *)outputBus {
@@ -104,7 +128,7 @@
         output->prepareOutputBufferList(outputData, frameCount, false);
 
         state->setBuffers(nullptr, outputData);
-        state->processWithEvents(timestamp, frameCount, realtimeEventListHead, nil /* MIDIOutEventBlock */);
+        state->render(timestamp, frameCount, realtimeEventListHead);
 
         return noErr;
     };
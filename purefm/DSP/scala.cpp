@@ -0,0 +1,235 @@
+//
+//  scala.cpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#include "scala.hpp"
+#include "tables.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+
+// the lines which are not ! comments, leading blanks and line ends removed
+static std::vector<std::string>
+lines(std::string const &text) {
+    std::vector<std::string> out;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty() && line[0] == '!') {
+            continue;
+        }
+        size_t const start = line.find_first_not_of(" \t");
+        out.push_back(start == std::string::npos ? std::string() : line.substr(start));
+    }
+    return out;
+}
+
+static bool
+integer(std::string const &s, int *value) {
+    char *end;
+    long const v = std::strtol(s.c_str(), &end, 10);
+    if (end == s.c_str()) {
+        return false;
+    }
+    *value = (int)v;
+    return true;
+}
+
+// a scale degree: cents when it has a period, otherwise a ratio n/d or n
+static scala_result
+pitch(std::string const &s, double *cents) {
+    std::string const token = s.substr(0, s.find_first_of(" \t"));
+    if (token.empty()) {
+        return scala_syntax;
+    }
+    if (token.find('.') != std::string::npos) {
+        char *end;
+        *cents = std::strtod(token.c_str(), &end);
+        return end == token.c_str() ? scala_syntax : scala_ok;
+    }
+
+    char *end;
+    long const n = std::strtol(token.c_str(), &end, 10);
+    long d = 1;
+    if (end == token.c_str()) {
+        return scala_syntax;
+    }
+    if (*end == '/') {
+        char const *const denominator = end + 1;
+        d = std::strtol(denominator, &end, 10);
+        if (end == denominator) {
+            return scala_syntax;
+        }
+    }
+    if (n <= 0 || d <= 0) {
+        return scala_range;
+    }
+    *cents = 1200.0 * std::log2((double)n / (double)d);
+    return scala_ok;
+}
+
+scala_result
+scala_parse_scale(std::string const &text, scala_scale *scale) {
+    auto const l = lines(text);
+    int count;
+    if (l.size() < 2 || !integer(l[1], &count)) {
+        return scala_syntax;
+    }
+    if (count < 1 || count > 1024 || l.size() < 2 + (size_t)count) {
+        return scala_range;
+    }
+
+    scale->description = l[0];
+    scale->cents.resize(count);
+    for (int i = 0; i < count; ++i) {
+        scala_result const r = pitch(l[2 + i], &scale->cents[i]);
+        if (r != scala_ok) {
+            return r;
+        }
+    }
+    return scala_ok;
+}
+
+scala_result
+scala_parse_map(std::string const &text, scala_map *map) {
+    auto const l = lines(text);
+    if (l.size() < 7) {
+        return scala_syntax;
+    }
+    int *const fields[] = { &map->size, &map->first, &map->last, &map->middle, &map->reference };
+    for (int i = 0; i < 5; ++i) {
+        if (!integer(l[i], fields[i])) {
+            return scala_syntax;
+        }
+    }
+    char *end;
+    map->frequency = std::strtod(l[5].c_str(), &end);
+    if (end == l[5].c_str() || !integer(l[6], &map->octave)) {
+        return scala_syntax;
+    }
+    if (map->size < 0 || map->size > 1024 || map->frequency <= 0.0 ||
+        map->reference < 0 || map->reference > 127) {
+        return scala_range;
+    }
+
+    // entries left off the end are unmapped
+    map->degrees.assign(map->size, -1);
+    for (int i = 0; i < map->size && 7 + (size_t)i < l.size(); ++i) {
+        if (l[7 + i].empty() || l[7 + i][0] == 'x') {
+            continue;
+        }
+        if (!integer(l[7 + i], &map->degrees[i])) {
+            return scala_syntax;
+        }
+    }
+    return scala_ok;
+}
+
+static scala_result
+load(char const *path, std::string *text) {
+    FILE *f = std::fopen(path, "rb");
+    if (f == nullptr) {
+        return scala_io;
+    }
+    char buffer[4096];
+    size_t length;
+    while ((length = std::fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        text->append(buffer, length);
+    }
+    bool const error = std::ferror(f) != 0;
+    std::fclose(f);
+    return error ? scala_io : scala_ok;
+}
+
+scala_result
+scala_load_scale(char const *path, scala_scale *scale) {
+    std::string text;
+    scala_result const r = load(path, &text);
+    return r == scala_ok ? scala_parse_scale(text, scale) : r;
+}
+
+scala_result
+scala_load_map(char const *path, scala_map *map) {
+    std::string text;
+    scala_result const r = load(path, &text);
+    return r == scala_ok ? scala_parse_map(text, map) : r;
+}
+
+scala_map
+scala_default_map(scala_scale const &scale) {
+    scala_map map;
+    map.size = 0;
+    map.first = 0;
+    map.last = 127;
+    map.middle = 60;
+    map.reference = 60;
+    map.frequency = tables::middleC;
+    map.octave = (int)scale.cents.size();
+    return map;
+}
+
+static int
+floor_div(int a, int b) {
+    int q = a / b;
+    if ((a % b) != 0 && ((a < 0) != (b < 0))) {
+        q--;
+    }
+    return q;
+}
+
+// scale degree a key plays
+static bool
+degree(scala_map const &map, int key, int *d) {
+    int const offset = key - map.middle;
+    if (map.size == 0) {
+        *d = offset;
+        return true;
+    }
+    int const repeat = floor_div(offset, map.size);
+    int const entry = map.degrees[offset - repeat * map.size];
+    if (entry < 0) {
+        return false;
+    }
+    *d = repeat * map.octave + entry;
+    return true;
+}
+
+// cents of a scale degree above degree 0
+static double
+cents(scala_scale const &scale, int d) {
+    int const n = (int)scale.cents.size();
+    int const period = floor_div(d, n);
+    int const r = d - period * n;
+    return period * scale.cents[n - 1] + (r == 0 ? 0.0 : scale.cents[r - 1]);
+}
+
+key_table_ptr
+scala_compile(scala_scale const &scale, scala_map const &map) {
+    int reference;
+    if (scale.cents.empty() || !degree(map, map.reference, &reference)) {
+        return nullptr;
+    }
+
+    double const base = std::log2(map.frequency / tables::middleC) - cents(scale, reference) / 1200.0;
+    auto keys = std::make_shared<key_table>();
+    for (int key = 0; key < 128; ++key) {
+        int d;
+        if (key < map.first || key > map.last || !degree(map, key, &d)) {
+            keys->pitch[key] = key_table::unmapped;
+        } else {
+            keys->pitch[key] = (int)std::lround(4096.0 * (base + cents(scale, d) / 1200.0));
+        }
+    }
+    return keys;
+}
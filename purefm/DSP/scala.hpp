@@ -0,0 +1,55 @@
+//
+//  scala.hpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#ifndef scala_hpp
+#define scala_hpp
+
+#include "globals.hpp"
+
+#include <string>
+#include <vector>
+
+// scala tunings: a scale (.scl) of degrees above a base note, laid out across
+// the keyboard by a keyboard mapping (.kbm).
+
+typedef enum {
+    scala_ok = 0,
+    scala_syntax,   // not a scale or keyboard mapping we can read
+    scala_range,    // values out of range
+    scala_io        // file could not be read
+} scala_result;
+
+struct scala_scale {
+    std::string description;
+    std::vector<double> cents; // each degree above the base; the last is the period
+};
+
+struct scala_map {
+    int size;                   // keys in the pattern, 0 for one degree per key
+    int first;                  // keys retuned, the rest are unmapped
+    int last;
+    int middle;                 // key playing degree 0
+    int reference;              // key sounding at frequency
+    double frequency;
+    int octave;                 // degrees the pattern moves per repeat
+    std::vector<int> degrees;   // per key in the pattern, -1 for unmapped
+};
+
+scala_result scala_parse_scale(std::string const &text, scala_scale *);
+scala_result scala_parse_map(std::string const &text, scala_map *);
+scala_result scala_load_scale(char const *path, scala_scale *);
+scala_result scala_load_map(char const *path, scala_map *);
+
+// the mapping assumed without a .kbm: one degree per key from middle C,
+// which sounds at middle C
+scala_map scala_default_map(scala_scale const &);
+
+// per key pitch for patch::keys
+key_table_ptr scala_compile(scala_scale const &, scala_map const &);
+
+#endif /* scala_hpp */
@@ -0,0 +1,279 @@
+//
+//  smf.cpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#include "smf.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static uint32_t
+be(uint8_t const *p, int n) {
+    uint32_t v = 0;
+    for (int i = 0; i < n; ++i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+smf_reader::smf_reader() {
+    _file = nullptr;
+    _rate = 0.0;
+    _division = 1;
+    _smpte = false;
+    _error = false;
+    _tempo_tick = 0;
+    _tempo_seconds = 0.0;
+    _tick_seconds = 0.0;
+    _last = 0;
+}
+
+smf_reader::~smf_reader() {
+    close();
+}
+
+bool
+smf_reader::open(char const *path, double sampleRate) {
+    close();
+
+    _file = std::fopen(path, "rb");
+    if (_file == nullptr) {
+        return false;
+    }
+
+    uint8_t h[14];
+    if (std::fread(h, sizeof(h), 1, _file) != 1 ||
+        std::memcmp(h, "MThd", 4) != 0 || be(h + 4, 4) < 6) {
+        close();
+        return false;
+    }
+    int const tracks = (int)be(h + 10, 2);
+    _division = std::max(be(h + 12, 2), 1u);
+    _rate = sampleRate;
+
+    // seconds per tick from the division, or 120 bpm until a tempo change
+    _smpte = (_division & 0x8000) != 0;
+    if (_smpte) {
+        int const fps = 0x100 - (int)(_division >> 8);
+        _tick_seconds = 1.0 / ((fps == 29 ? 29.97 : (double)fps) * (double)std::max(_division & 0xff, 1u));
+    } else {
+        _tick_seconds = 0.5 / (double)_division;
+    }
+
+    // only the chunk headers are read here; unknown chunks are skipped
+    long offset = 8 + (long)be(h + 4, 4);
+    while ((int)_tracks.size() < tracks) {
+        uint8_t c[8];
+        if (std::fseek(_file, offset, SEEK_SET) != 0 || std::fread(c, sizeof(c), 1, _file) != 1) {
+            break;
+        }
+        long const length = (long)be(c + 4, 4);
+        if (std::memcmp(c, "MTrk", 4) == 0) {
+            track t;
+            t.offset = offset + 8;
+            t.end = t.offset + length;
+            t.head = 0;
+            t.fill = 0;
+            t.tick = 0;
+            t.status = 0;
+            t.pending = false;
+            t.tempo = false;
+            t.value = 0;
+            _tracks.push_back(t);
+        }
+        offset += 8 + length;
+    }
+
+    for (auto &t : _tracks) {
+        fetch(t);
+    }
+    if (_error) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void
+smf_reader::close() {
+    if (_file != nullptr) {
+        std::fclose(_file);
+    }
+    _file = nullptr;
+    _tracks.clear();
+    _error = false;
+    _tempo_tick = 0;
+    _tempo_seconds = 0.0;
+    _last = 0;
+}
+
+bool
+smf_reader::byte(track &t, uint8_t *b) {
+    if (t.head == t.fill) {
+        long const n = std::min((long)sizeof(t.buffer), t.end - t.offset);
+        if (n <= 0 || std::fseek(_file, t.offset, SEEK_SET) != 0 ||
+            std::fread(t.buffer, (size_t)n, 1, _file) != 1) {
+            return false;
+        }
+        t.offset += n;
+        t.head = 0;
+        t.fill = (int)n;
+    }
+    *b = t.buffer[t.head++];
+    return true;
+}
+
+bool
+smf_reader::varlen(track &t, uint32_t *v) {
+    *v = 0;
+    for (int i = 0; i < 4; ++i) {
+        uint8_t b;
+        if (!byte(t, &b)) {
+            return false;
+        }
+        *v = (*v << 7) | (b & 0x7f);
+        if ((b & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+smf_reader::skip(track &t, uint32_t n) {
+    uint8_t b;
+    while (n-- > 0) {
+        if (!byte(t, &b)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// parse ahead to the track's next channel message or tempo change
+void
+smf_reader::fetch(track &t) {
+    t.pending = false;
+
+    while (t.head < t.fill || t.offset < t.end) {
+        uint32_t delta;
+        uint8_t b;
+        if (!varlen(t, &delta) || !byte(t, &b)) {
+            _error = true;
+            return;
+        }
+        t.tick += delta;
+
+        if (b == 0xff) {
+            uint8_t type;
+            uint32_t length;
+            if (!byte(t, &type) || !varlen(t, &length)) {
+                _error = true;
+                return;
+            }
+            if (type == 0x51 && length == 3) {
+                uint8_t v[3];
+                if (!byte(t, &v[0]) || !byte(t, &v[1]) || !byte(t, &v[2])) {
+                    _error = true;
+                    return;
+                }
+                t.tempo = true;
+                t.value = be(v, 3);
+                t.pending = true;
+                return;
+            }
+            if (type == 0x2f) {
+                return; // end of track
+            }
+            if (!skip(t, length)) {
+                _error = true;
+                return;
+            }
+            continue;
+        }
+        if (b == 0xf0 || b == 0xf7) {
+            // sysex also cancels running status
+            uint32_t length;
+            if (!varlen(t, &length) || !skip(t, length)) {
+                _error = true;
+                return;
+            }
+            t.status = 0;
+            continue;
+        }
+
+        int n = 1;
+        if ((b & 0x80) != 0) {
+            t.status = b;
+        } else if (t.status != 0) {
+            t.data[1] = b; // running status
+            n = 2;
+        } else {
+            _error = true;
+            return;
+        }
+        t.data[0] = t.status;
+        t.data[2] = 0;
+
+        int const length = ((t.status & 0xe0) == 0xc0) ? 2 : 3;
+        for (int i = n; i < length; ++i) {
+            if (!byte(t, &t.data[i])) {
+                _error = true;
+                return;
+            }
+        }
+        t.tempo = false;
+        t.pending = true;
+        return;
+    }
+}
+
+// from the last tempo change rather than summed per event, so long files
+// don't drift
+uint64_t
+smf_reader::frame(uint64_t tick) const {
+    double const seconds = _tempo_seconds + (double)(tick - _tempo_tick) * _tick_seconds;
+    return (uint64_t)std::llround(seconds * _rate);
+}
+
+bool
+smf_reader::read(uint64_t end, std::vector<midi_event> *events) {
+    while (!_error) {
+        // earliest waiting event; ties go to the earlier track
+        track *next = nullptr;
+        for (auto &t : _tracks) {
+            if (t.pending && (next == nullptr || t.tick < next->tick)) {
+                next = &t;
+            }
+        }
+        if (next == nullptr) {
+            return false;
+        }
+
+        uint64_t const f = frame(next->tick);
+        if (f >= end) {
+            return true;
+        }
+
+        if (next->tempo) {
+            if (!_smpte) {
+                _tempo_seconds += (double)(next->tick - _tempo_tick) * _tick_seconds;
+                _tempo_tick = next->tick;
+                _tick_seconds = (double)next->value / 1000000.0 / (double)_division;
+            }
+        } else {
+            midi_event m;
+            m.frame = f;
+            std::memcpy(m.data, next->data, 3);
+            events->push_back(m);
+            _last = f;
+        }
+        fetch(*next);
+    }
+    return false;
+}
@@ -0,0 +1,79 @@
+//
+//  smf.hpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#ifndef smf_hpp
+#define smf_hpp
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// a channel message at a sample frame from the start of the song
+struct midi_event {
+    uint64_t frame;
+    unsigned char data[3];
+};
+
+// streams a standard midi file (format 0 or 1) as channel messages in time
+// order, with the tempo map applied at the render sample rate. each track is
+// read through its own small buffer; the file is never loaded whole.
+class smf_reader {
+    public:
+        smf_reader();
+        virtual ~smf_reader();
+
+        bool open(char const *path, double sampleRate);
+        void close();
+
+        // append the events before frame end (one render block past the last
+        // call). false once there are no events left or the file is malformed.
+        bool read(uint64_t end, std::vector<midi_event> *events);
+
+        bool error() const { return _error; }
+
+        // frame of the last event read
+        uint64_t last() const { return _last; }
+
+    private:
+        struct track {
+            long offset;        // file position of the next buffer fill
+            long end;
+            uint8_t buffer[256];
+            int head;
+            int fill;
+            uint64_t tick;
+            uint8_t status;     // running status
+            bool pending;       // next event is parsed and waiting
+            bool tempo;         // waiting event is a tempo change
+            uint32_t value;     // microseconds per quarter when tempo
+            unsigned char data[3];
+        };
+
+        bool byte(track &t, uint8_t *b);
+        bool varlen(track &t, uint32_t *v);
+        bool skip(track &t, uint32_t n);
+        void fetch(track &t);
+        uint64_t frame(uint64_t tick) const;
+
+    private:
+        FILE *_file;
+        std::vector<track> _tracks;
+        double _rate;
+        uint32_t _division;
+        bool _smpte;
+        bool _error;
+
+        // the tempo map so far
+        uint64_t _tempo_tick;
+        double _tempo_seconds;
+        double _tick_seconds;
+
+        uint64_t _last;
+};
+
+#endif /* smf_hpp */
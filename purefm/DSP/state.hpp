@@ -0,0 +1,66 @@
+//
+//  state.hpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#ifndef state_hpp
+#define state_hpp
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+//
+// flat binary running state. a class with state has
+//
+//   template<class Archive>
+//   void serialize(Archive &a) { a(_level); a(_out); _stage.serialize(a); }
+//
+// and the same member list drives both directions. only values are written;
+// wiring between objects and pointers into the patch are left to update().
+
+class state_writer {
+    public:
+        state_writer(std::vector<uint8_t> *out) : _out(out) {}
+
+        template<class T>
+        void operator()(T &v) {
+            static_assert(std::is_trivially_copyable<T>::value, "plain values only");
+            auto const *p = reinterpret_cast<uint8_t const *>(&v);
+            _out->insert(_out->end(), p, p + sizeof(T));
+        }
+
+    private:
+        std::vector<uint8_t> *_out;
+};
+
+class state_reader {
+    public:
+        state_reader(std::vector<uint8_t> const &in) : _p(in.data()), _end(in.data() + in.size()) {}
+
+        template<class T>
+        void operator()(T &v) {
+            static_assert(std::is_trivially_copyable<T>::value, "plain values only");
+            if ((size_t)(_end - _p) < sizeof(T)) {
+                _p = _end;
+                _ok = false;
+                return;
+            }
+            std::memcpy(&v, _p, sizeof(T));
+            _p += sizeof(T);
+        }
+
+        // everything read was there
+        bool ok() const { return _ok; }
+
+    private:
+        uint8_t const *_p;
+        uint8_t const *_end;
+        bool _ok = true;
+};
+
+#endif /* state_hpp */
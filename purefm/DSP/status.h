@@ -15,13 +15,33 @@ struct eg_status {
 };
 
 struct voice_status {
-    struct eg_status const *pitch;
-    struct eg_status const *lfo;
-    struct eg_status const *ops[8];
+    struct eg_status pitch;
+    struct eg_status lfo;
+    struct eg_status ops[8];
 };
 
+// the most recently started voice, taken once per render block while the
+// reader asks for it, see status_snapshot in telemetry.hpp
 struct status {
-    struct voice_status const *voice;
+    int playing;                    // nonzero if the voice is sounding
+    struct voice_status voice;
+};
+
+// counters for one render block, see telemetry.hpp
+struct block_stats {
+    unsigned long long block;       // render block sequence number
+    unsigned frames;                // frames rendered in the block
+    unsigned dropped;               // blocks lost to a full ring before this one
+    int active_voices;              // voices sounding at the end of the block
+    int voices_stolen;              // sounding voices taken for a new note
+    int voices_culled;              // released voices cut short to shed load
+    int control_drops;              // times the control rate was lowered to shed load
+    int control_shift;              // control rate lowered by, as a power of 2
+    int events;                     // midi events processed
+    int patch_swaps;                // patch updates applied
+    unsigned patch_serial;          // count of patch updates since start
+    unsigned long long render_ns;   // time spent rendering the block
+    unsigned long long max_ns;      // longest block so far
 };
 
 #endif /* status_h */
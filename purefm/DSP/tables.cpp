@@ -25,16 +25,28 @@ tables::init(double sampleRate)
         // logsin of quarter arc
         double y = std::sin(x / (double)0x8000 * M_PI);
         y = -std::log2(y);
-        _logsin[n] = (int)std::round(y * (double)0x4000);
+        int l = std::min((int)std::round(y * (double)0x4000), log_silent);
+        if (n < log_head) {
+            _logsin_head[n] = l;
+            _logsin[n] = 0xffff;
+        } else {
+            _logsin[n] = (uint16_t)l;
+        }
 
         // log complementing each exp
         x = x / (double)0x4000;
         y = -std::log2(x);
-        _log[n] = (int)std::round(y * (double)0x4000);
-
-        // exp complementing each log or logsin
+        l = std::min((int)std::round(y * (double)0x4000), log_silent);
+        if (n < log_head) {
+            _log_head[n] = l;
+            _log[n] = 0xffff;
+        } else {
+            _log[n] = (uint16_t)l;
+        }
+
+        // exp complementing each log or logsin, in (0x8000-0x10000)
         y = std::exp2(x);
-        _exp[n ^ 0x3fff] = (int)std::round(y * (double)0x8000);
+        _exp[n ^ 0x3fff] = (uint16_t)((int)std::round(y * (double)0x8000) - 0x8000);
     }
 
     double const hz = middleC * (65536.0 / sampleRate);
@@ -10,6 +10,7 @@
 #define tables_hpp
 
 #include <algorithm>
+#include <cstdint>
 
 const int eg_max = 0x7fffff;
 const int eg_mid = 0x000000;
@@ -17,9 +18,18 @@ const int eg_min = -0x800000;
 
 class tables {
     private:
-        int _logsin[0x4000];
-        int _exp[0x4000];
-        int _log[0x4000];
+        // log values are 14 bit fraction over an integer shift and only fit
+        // in 16 bits away from the steep end near zero. the first log_head
+        // entries of each are kept full width in their own small tables.
+        static constexpr int log_head = 0x400;
+        // a log value at or past this shifts any exp output to zero
+        static constexpr int log_silent = 17 << 14;
+
+        uint16_t _logsin[0x4000];
+        uint16_t _log[0x4000];
+        uint16_t _exp[0x4000]; // offset from 0x8000
+        int _logsin_head[log_head];
+        int _log_head[log_head];
         long _notes[0x1000];
         int _scale[12];
 
@@ -30,15 +40,21 @@ class tables {
         void init(double sampleRate);
 
         inline int logsin(int phase) const {
+            if (phase < log_head) {
+                return _logsin_head[phase];
+            }
             return _logsin[phase];
         }
 
         inline int log(int phase) const {
+            if (phase < log_head) {
+                return _log_head[phase];
+            }
             return _log[phase];
         }
 
         inline int exp(int l) const {
-            int n = _exp[l & 0x3fff];
+            int n = _exp[l & 0x3fff] + 0x8000;
             return n >> (l >> 14);
         }
 
@@ -80,7 +96,7 @@ class tables {
 
             envelope >>= 6; // [0-16] << 14 + [0-16384)
             input += envelope;
-            int out = _exp[input & 0x3fff];
+            int out = _exp[input & 0x3fff] + 0x8000;
             out >>= (input >> 14);
             return out << 7; // signed 24 bit value (in positive range)
         }
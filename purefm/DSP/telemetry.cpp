@@ -0,0 +1,53 @@
+//
+//  telemetry.cpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#include "telemetry.hpp"
+#include "engine.hpp"
+
+#include <algorithm>
+
+telemetry::telemetry() {
+    _block = 0;
+    _max_ns = 0;
+    _dropped = 0;
+    _rate = 0.0;
+}
+
+telemetry::~telemetry() {
+}
+
+void
+telemetry::begin() {
+    _start = clock::now();
+}
+
+void
+telemetry::end(engine &e, unsigned frames) {
+    auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        clock::now() - _start).count();
+
+    // shed load for the next block if this one came near its deadline
+    if (_rate > 0.0 && frames > 0) {
+        e.load((double)ns * _rate / (1e9 * frames));
+    }
+
+    block_stats stats;
+    e.take_stats(&stats);
+    stats.block = _block++;
+    stats.frames = frames;
+    stats.dropped = _dropped;
+    stats.render_ns = (unsigned long long)ns;
+    _max_ns = std::max(_max_ns, stats.render_ns);
+    stats.max_ns = _max_ns;
+
+    if (_ring.push(stats)) {
+        _dropped = 0;
+    } else {
+        _dropped++;
+    }
+}
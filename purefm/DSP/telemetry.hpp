@@ -0,0 +1,146 @@
+//
+//  telemetry.hpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#ifndef telemetry_hpp
+#define telemetry_hpp
+
+#include "status.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+class engine;
+
+//
+// lock free single producer, single consumer ring.
+// the producer never waits; push() fails if the consumer has fallen behind.
+template<class T, size_t N>
+class spsc_ring {
+    static_assert((N & (N - 1)) == 0, "ring size must be a power of 2");
+
+    public:
+        spsc_ring() : _head(0), _tail(0) {}
+        ~spsc_ring() {}
+
+        // producer
+        bool push(T const &item) {
+            size_t const head = _head.load(std::memory_order_relaxed);
+            if (head - _tail.load(std::memory_order_acquire) == N) {
+                return false;
+            }
+            _items[head & (N - 1)] = item;
+            _head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // consumer
+        bool pop(T *item) {
+            size_t const tail = _tail.load(std::memory_order_relaxed);
+            if (_head.load(std::memory_order_acquire) == tail) {
+                return false;
+            }
+            *item = _items[tail & (N - 1)];
+            _tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        alignas(64) std::atomic<size_t> _head;
+        alignas(64) std::atomic<size_t> _tail;
+        T _items[N];
+};
+
+//
+// the latest status for a non-realtime reader, written once per render block
+// and only while enabled, so the render path stores nothing for a reader
+// which isn't looking. the render thread writes the buffer the reader is not
+// pointed at; a buffer's sequence is odd while it is being written, and a
+// reader which raced a write sees its sequence move and reads again.
+class status_snapshot {
+    public:
+        status_snapshot() : _enabled(false), _front(0) {
+            _seq[0].store(0, std::memory_order_relaxed);
+            _seq[1].store(0, std::memory_order_relaxed);
+        }
+        ~status_snapshot() {}
+
+        void enable(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+        bool enabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+        // render thread: fill in the returned buffer, then publish() it
+        struct status *write() {
+            unsigned const back = _front.load(std::memory_order_relaxed) ^ 1;
+            _seq[back].fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            return &_buffers[back];
+        }
+
+        void publish() {
+            unsigned const back = _front.load(std::memory_order_relaxed) ^ 1;
+            _seq[back].fetch_add(1, std::memory_order_release);
+            _front.store(back, std::memory_order_release);
+        }
+
+        // reader: a copy of the last status published, false if none yet
+        bool read(struct status *s) const {
+            for (;;) {
+                unsigned const front = _front.load(std::memory_order_acquire);
+                unsigned const seq = _seq[front].load(std::memory_order_acquire);
+                if (seq == 0) {
+                    return false;
+                }
+                if ((seq & 1) != 0) {
+                    continue;
+                }
+                *s = _buffers[front];
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (_seq[front].load(std::memory_order_relaxed) == seq) {
+                    return true;
+                }
+            }
+        }
+
+    private:
+        std::atomic<bool> _enabled;
+        std::atomic<unsigned> _front;
+        std::atomic<unsigned> _seq[2];
+        struct status _buffers[2];
+};
+
+//
+// per render block counters, collected on the render thread around each
+// block and read back from any one non-realtime thread.
+class telemetry {
+    public:
+        telemetry();
+        ~telemetry();
+
+        // the sample rate blocks are measured against, for load shedding
+        // (engine::load()); none until set.
+        void set_rate(double rate) { _rate = rate; }
+
+        // render thread
+        void begin();
+        void end(engine &, unsigned frames);
+
+        // reader: oldest block not yet read, false if none
+        bool pop(block_stats *stats) { return _ring.pop(stats); }
+
+    private:
+        typedef std::chrono::steady_clock clock;
+
+        spsc_ring<block_stats, 256> _ring;
+        clock::time_point _start;
+        unsigned long long _block;
+        unsigned long long _max_ns;
+        unsigned _dropped;
+        double _rate;
+};
+
+#endif /* telemetry_hpp */
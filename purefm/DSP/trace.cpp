@@ -0,0 +1,104 @@
+//
+//  trace.cpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#include "trace.hpp"
+
+#ifdef PUREFM_TRACE
+
+#include <vector>
+
+namespace trace {
+
+int size = 0;
+
+static std::vector< record > records;
+static std::vector< buffer > buffers;
+static std::atomic<int> claimed(0);
+static std::atomic<unsigned> generation(0); // of buffers, bumped by init()
+static std::chrono::steady_clock::time_point base;
+
+void
+init(int threads, int records_per_thread) {
+    size = records_per_thread;
+    records.assign((size_t)threads * size, record());
+    buffers.assign(threads, buffer());
+    for (int i = 0; i < threads; ++i) {
+        buffers[i].records = &records[(size_t)i * size];
+        buffers[i].count = 0;
+        buffers[i].thread = i + 1;
+    }
+    claimed = 0;
+    base = std::chrono::steady_clock::now();
+    generation++;
+}
+
+uint64_t
+now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - base).count();
+}
+
+buffer *
+this_thread() {
+    // claimed without locking or allocation; threads past the last
+    // preallocated buffer are not traced. a thread claims again after each
+    // init(), which replaces the buffers, and not before the first.
+    static thread_local buffer *b = nullptr;
+    static thread_local unsigned seen = 0;
+    unsigned const g = generation.load(std::memory_order_acquire);
+    if (seen != g) {
+        seen = g;
+        b = nullptr;
+        int const i = claimed++;
+        if (i < (int)buffers.size()) {
+            b = &buffers[i];
+        }
+    }
+    return b;
+}
+
+void
+write_json(FILE *f) {
+    bool first = true;
+    std::fprintf(f, "{\"traceEvents\":[\n");
+    for (auto const &b : buffers) {
+        uint64_t const n = b.count < (uint64_t)size ? b.count : (uint64_t)size;
+        for (uint64_t i = b.count - n; i < b.count; ++i) {
+            record const &r = b.records[i % size];
+            std::fprintf(f, "%s", first ? "" : ",\n");
+            first = false;
+            if (r.instant) {
+                std::fprintf(f,
+                    "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,"
+                    "\"pid\":1,\"tid\":%d,\"args\":{\"arg\":%d}}",
+                    r.name, (double)r.begin / 1000.0, b.thread, r.arg);
+            } else {
+                std::fprintf(f,
+                    "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"pid\":1,\"tid\":%d}",
+                    r.name, (double)r.begin / 1000.0,
+                    (double)(r.end - r.begin) / 1000.0, b.thread);
+            }
+        }
+    }
+    std::fprintf(f, "\n],\"displayTimeUnit\":\"ns\"}\n");
+}
+
+bool
+write_json(char const *path) {
+    FILE *f = std::fopen(path, "w");
+    if (f == nullptr) {
+        return false;
+    }
+    write_json(f);
+    return std::fclose(f) == 0;
+}
+
+} // namespace trace
+
+#endif // PUREFM_TRACE
@@ -0,0 +1,97 @@
+//
+//  trace.hpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#ifndef trace_hpp
+#define trace_hpp
+
+//
+// trace points in the render path, built only with PUREFM_TRACE defined.
+// otherwise the macros below compile to nothing.
+//
+// TRACE_SCOPE(name)        duration of the enclosing scope
+// TRACE_INSTANT(name, arg) a single point in time with an integer argument
+//
+// names must be string literals (or otherwise live forever). records are
+// fixed size and written to a buffer per thread, preallocated by
+// trace::init() before rendering starts; a thread claims its buffer with
+// its first record, and each buffer keeps its most recent records.
+// trace::write_json() dumps everything in Chrome trace event format, for
+// chrome://tracing or Perfetto, and should be called while not rendering.
+
+#ifdef PUREFM_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace trace {
+
+struct record {
+    char const *name;
+    uint64_t begin;     // ns since init()
+    uint64_t end;
+    int arg;
+    bool instant;
+};
+
+struct buffer {
+    record *records;
+    uint64_t count;     // records written, including those overwritten
+    int thread;
+};
+
+extern int size; // records per buffer
+
+// allocate buffers for up to threads threads of size records each
+void init(int threads, int size);
+void write_json(FILE *);
+bool write_json(char const *path);
+
+buffer *this_thread();
+uint64_t now();
+
+inline void
+add(char const *name, uint64_t begin, uint64_t end, int arg, bool instant) {
+    buffer *b = this_thread();
+    if (b != nullptr) {
+        record &r = b->records[b->count++ % size];
+        r.name = name;
+        r.begin = begin;
+        r.end = end;
+        r.arg = arg;
+        r.instant = instant;
+    }
+}
+
+class scope {
+    public:
+        scope(char const *name) : _name(name), _begin(now()) {}
+        ~scope() { add(_name, _begin, now(), 0, false); }
+
+    private:
+        char const *_name;
+        uint64_t _begin;
+};
+
+} // namespace trace
+
+#define TRACE_CONCAT2(a, b) a ## b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_SCOPE(name) trace::scope TRACE_CONCAT(_trace_, __LINE__)(name)
+#define TRACE_INSTANT(name, arg) \
+    do { uint64_t const _t = trace::now(); trace::add((name), _t, _t, (arg), true); } while (0)
+
+#else
+
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_INSTANT(name, arg) do {} while (0)
+
+#endif // PUREFM_TRACE
+
+#endif /* trace_hpp */
@@ -8,6 +8,7 @@
 
 #include "voice.hpp"
 #include "globals.hpp"
+#include "trace.hpp"
 
 #include <algorithm>
 
@@ -53,8 +54,10 @@ highest(uint64_t bits) {
 }
 
 voice::voice(globals const *g) :
-    _algo(g, _lfo_output, _pitch, _pressure), _lfo(g), _pitch_env(g) {
+    _algo(g, _part, _lfo_output, _pitch, _pressure), _lfo(g, _part), _pitch_env(g, _part) {
     _globals = g;
+    _part = &g->parts[0];
+    _part_index = 0;
     _counter = 0;
     _lfo_output = 0;
     _patch = nullptr;
@@ -64,33 +67,49 @@ voice::voice(globals const *g) :
     _pitch_env.init_at(0);
     std::fill_n(_keys, 16, 0);
     std::fill_n(_output, 16, 0);
-    for (int i = 0; i < 8; ++i) {
-        _status.ops[i] = _algo.get_eg_status(i);
-    }
-    _status.pitch = _pitch_env.get_status();
-    _status.lfo = _lfo.get_status();
+    std::fill_n(_side, 16, 0);
     _pressure = 0;
     _pressure_in = 0;
     _priority = 0;
+    _cache = nullptr;
+    _patch_hash = 0;
+    _play = nullptr;
+    _rec = nullptr;
+    _group = 0;
+    _deterministic = false;
 }
 
 voice::~voice() {
+    leave(false);
 }
 
 void
-voice::update(patch const *patch) {
+voice::update(patch const *patch, bool reset) {
+    leave();
     _patch = patch;
-    _algo.update(patch);
+    _deterministic = deterministic(patch);
+    _algo.update(patch, reset);
 
     if (patch != nullptr) {
-        _pitch_env.update(patch->pitch_env.get(), true);
-        _lfo.update(patch->lfo.get());
+        _pitch_env.update(patch->pitch_env.get(), reset);
+        _lfo.update(patch->lfo.get(), reset);
     } else {
         _pitch_env.update(nullptr, true);
         _lfo.update(nullptr);
     }
 }
 
+void
+voice::set_part(int part) {
+    if (part != _part_index) {
+        // held mono keys belonged to the other part
+        _keys[0] = 0;
+        _keys[1] = 0;
+    }
+    _part_index = part;
+    _part = &_globals->parts[part];
+}
+
 int
 voice::highest_key() const {
     if (_keys[1] != 0) {
@@ -101,6 +120,7 @@ voice::highest_key() const {
 
 void
 voice::start(patch const *patch, int key, int velocity) {
+    leave();
     _patch = patch;
     if (patch == nullptr) {
         return;
@@ -130,7 +150,7 @@ voice::start(patch const *patch, int key, int velocity) {
         }
     }
 
-    int f = _globals->t.scale(key - _patch->middle_c) + _patch->tuning;
+    int f = key_pitch(key) + _patch->tuning;
     if (!_patch->mono || _velocity == 0) {
         _freq_eg.set(f << 8, f << 8, _patch->portamento);
     } else {
@@ -143,6 +163,22 @@ voice::start(patch const *patch, int key, int velocity) {
     _lfo.start(_patch->lfo.get(), velocity);
     _algo.start(patch, key, velocity);
     _pitch_env.start(_patch->pitch_env.get(), 0, 0, velocity > 0);
+
+    if (velocity > 0 && _cache != nullptr) {
+        cache();
+    }
+}
+
+int
+voice::key_pitch(int key) const {
+    auto const *keys = _patch->keys.get();
+    if (keys != nullptr) {
+        int const pitch = keys->lookup(key, _patch->middle_c);
+        if (pitch != key_table::unmapped) {
+            return pitch;
+        }
+    }
+    return _globals->t.scale(key - _patch->middle_c);
 }
 
 void
@@ -150,30 +186,245 @@ voice::pressure(int pressure) {
     _pressure_in = pressure << 5;
 }
 
-int
-voice::step() {
+void
+voice::mix(int *out, int *side, int count) {
     if (_patch == nullptr) {
-        return 0;
+        _counter += count;
+        return;
+    }
+
+    // run the engine 16 samples ahead. pressure is only read by the group
+    // rendered on the first sample, so it moves there and then the rest of
+    // the way at once.
+    _pressure = smooth(_pressure, _pressure_in, 1);
+    if ((_counter & 0x0f) == 0) {
+        if (_play != nullptr) {
+            play();
+        } else if (_rec != nullptr) {
+            record();
+        } else {
+            render(_output, _side);
+        }
     }
+    _pressure = smooth(_pressure, _pressure_in, count - 1);
 
-    if (_pressure < _pressure_in) {
-        _pressure++;
+    int const *output = _output + (_counter & 0x0f);
+    for (int i = 0; i < count; ++i) {
+        out[i] += output[i];
     }
-    else if (_pressure > _pressure_in) {
-        _pressure--;
+    if (side != nullptr && _algo.copies() > 1) {
+        int const *s = _side + (_counter & 0x0f);
+        for (int i = 0; i < count; ++i) {
+            side[i] += s[i];
+        }
     }
+    _counter += count;
+}
 
-    if ((_counter & 0x0f) == 0) {
-        // lfo, pitch every 16 (per eg step)
-        if (((_counter >> 4) & _globals->eg_mask) == 0) {
-            _lfo_output = _lfo.step();
-            int const bias = _pitch_env.pitch_bias(_lfo_output);
-            _pitch = _pitch_env.pitch_value(_pitch_env.step(16, bias)) +
-                (_freq_eg.step(16) >> 8);
+void
+voice::get_status(voice_status *s) const {
+    s->pitch = _pitch_env.get_status(_pitch_env.pitch_bias(_lfo_output));
+    s->lfo = _lfo.get_status();
+    for (int i = 0; i < 8; ++i) {
+        s->ops[i] = _algo.get_eg_status(i);
+    }
+}
+
+int
+voice::level() const {
+    int peak = 0;
+    for (int o : _output) {
+        peak = std::max(peak, std::abs(o));
+    }
+    return peak;
+}
+
+void
+voice::cull() {
+    leave(false);
+    update(nullptr);
+}
+
+void
+voice::skip(uint64_t frames) {
+    _counter += (unsigned)frames;
+    if (_patch != nullptr) {
+        _pressure = smooth(_pressure, _pressure_in, frames);
+    }
+}
+
+void
+voice::render(int *output, int *side) {
+    TRACE_SCOPE("voice::render");
+
+    // lfo, pitch every 16 (per eg step)
+    if (((_counter >> 4) & _globals->eg_mask) == 0) {
+        _lfo_output = _lfo.step();
+        int const bias = _pitch_env.pitch_bias(_lfo_output);
+        _pitch = _pitch_env.pitch_value(_pitch_env.step(16, bias)) +
+            (_freq_eg.step(16) >> 8);
+    }
+
+    _algo.step(output, side);
+}
+
+// MARK: note cache
+
+void
+voice::set_cache(note_cache *cache, uint64_t patch) {
+    if (cache != _cache) {
+        leave();
+    }
+    _cache = cache;
+    _patch_hash = patch;
+}
+
+// the same patch, key, velocity, inputs and state at note on always play out
+// the same way while held: no noise, no free running lfo, every sounding op
+// restarting its phase, and no held keys from another note (mono). the
+// cache only keeps one channel, so no unison either.
+bool
+voice::deterministic(patch const *patch) {
+    if (patch == nullptr || patch->mono || patch->unison > 1) {
+        return false;
+    }
+    for (auto const &op : patch->ops) {
+        if (op->enabled && !op->resync) {
+            return false;
+        }
+    }
+    auto const *lfo = patch->lfo.get();
+    if (lfo != nullptr) {
+        auto const *wave = lfo->wave.get();
+        if (!lfo->resync || dynamic_cast<noise const *>(wave) != nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// clear what the first group overwrites before reading, so notes started
+// after different histories still find each other.
+void
+voice::settle() {
+    _lfo_output = 0;
+    _pitch = 0;
+    _algo.settle();
+    _lfo.settle();
+    _pitch_env.settle();
+}
+
+void
+voice::cache() {
+    // every group is a control tick only without an eg rate divider.
+    // automation isn't among a note's inputs, so it plays live.
+    if (!_deterministic || _globals->eg_mask != 0 || _globals->control_shift != 0 ||
+        _pressure != _pressure_in || _part->automated) {
+        return;
+    }
+    settle();
+    _state.clear();
+    state_writer w(&_state);
+    serialize(w);
+
+    bool recording;
+    note_entry *e = _cache->begin(_patch_hash, _key, _velocity, inputs(), _state, &recording);
+    _group = 0;
+    if (e == nullptr) {
+        return;
+    }
+    if (recording) {
+        _rec = e;
+    } else {
+        _play = e;
+    }
+}
+
+void
+voice::play() {
+    note_entry const *e = _play;
+    if (_group < e->groups() && inputs() == e->inputs && !_part->automated) {
+        std::copy_n(e->samples.data() + (_group << 4), 16, _output);
+        _group++;
+        return;
+    }
+    resume();
+    render(_output, _side);
+}
+
+void
+voice::record() {
+    note_entry *e = _rec;
+    bool keep = (inputs() == e->inputs);
+    if (keep && _group > 0 && (_group % note_cache::checkpoint_groups) == 0) {
+        _state.clear();
+        state_writer w(&_state);
+        serialize(w);
+        keep = _cache->checkpoint(e, _state);
+    }
+
+    render(_output, _side);
+
+    if (keep && _cache->append(e, _output)) {
+        _group++;
+        if (!_algo.idle()) {
+            return;
         }
+        e->idle = _group;
+    }
+    _cache->finish(e);
+    _rec = nullptr;
+}
+
+// live synthesis picks up from the state after the groups already played:
+// the nearest checkpoint at or before, then run forward from there under the
+// inputs the note was recorded with, which may have just moved.
+void
+voice::resume() {
+    note_entry *e = _play;
+    int const k = std::min(_group / note_cache::checkpoint_groups, (int)e->checkpoints.size() - 1);
+    state_reader r(e->checkpoints[k]);
+    serialize(r);
+
+    part held;
+    held.lfo = _part->lfo;
+    held.mod_wheel = e->inputs.mod_wheel;
+    held.pitch_bend = e->inputs.pitch_bend;
+    held.sustain_pedal = _part->sustain_pedal;
+    held.automated = false; // as recorded
+    for (auto &p : held.params) {
+        p.set = false;
+    }
+
+    part const *live = _part;
+    int const pressure = _pressure;
+    _part = &held;
+    _pressure = e->inputs.pressure;
+
+    int skip[16], side[16];
+    for (int g = k * note_cache::checkpoint_groups; g < _group; ++g) {
+        render(skip, side);
+    }
 
-        // run the engine 16 samples ahead
-        _algo.step(_output);
+    _part = live;
+    _pressure = pressure;
+    _cache->release(e, _group < e->groups());
+    _play = nullptr;
+}
+
+// stop playing or recording, with the voice live where the note is now
+void
+voice::leave(bool live) {
+    if (_play != nullptr) {
+        if (live) {
+            resume();
+        } else {
+            _cache->release(_play);
+            _play = nullptr;
+        }
+    }
+    if (_rec != nullptr) {
+        _cache->finish(_rec);
+        _rec = nullptr;
     }
-    return _output[_counter++ & 0x0f];
 }
@@ -10,40 +10,124 @@
 #define voice_hpp
 
 #include "algo.hpp"
+#include "cache.hpp"
 #include "env.hpp"
 #include "lfosc.hpp"
 #include "globals.hpp"
 
+#include <algorithm>
 #include <cstdint>
+#include <vector>
 
-class voice {
+// cache line aligned, for the engine's voice bank
+class alignas(64) voice {
     public:
         voice(globals const *);
-        virtual ~voice();
+        ~voice();
 
-        // out of band global parameters
-        void update(patch const *);
+        // out of band global parameters.
+        // without reset, a sounding voice is rewired to the patch as it plays.
+        void update(patch const *, bool reset = true);
 
         // key up indicated with 0 velocity
         void start(patch const *, int key, int velocity);
-        int step();
         void pressure(int pressure);
 
+        // add the next count samples into out, no further than the end of
+        // the current group of 16, and their stereo side (algo::step()) into
+        // side if not null. the voice clock runs with or without a patch.
+        void mix(int *out, int *side, int count);
+
+        // the clock and pressure smoothing of that many samples, without rendering
+        void skip(uint64_t frames);
+
+        // play notes back from the cache where recorded, recording them where
+        // not. patch is the content hash of the patch for the next start().
+        void set_cache(note_cache *, uint64_t patch);
+
+        // the part (midi channel in multi timbral mode) this voice plays
+        int get_part() const { return _part_index; }
+        void set_part(int part);
+        patch const *get_patch() const { return _patch; }
+
         int get_key() const { return _key; }
+        bool idle() const {
+            return _play != nullptr ? (_play->idle >= 0 && _group >= _play->idle) : _algo.idle();
+        }
         bool triggered() const { return _velocity != 0; }
-        voice_status const *get_status() const { return &_status; }
+
+        // peak output of the last group rendered
+        int level() const;
+
+        // silence now, to shed load. the next note starts it again.
+        void cull();
+        void get_status(voice_status *) const;
 
         uint64_t get_priority() const { return _priority; }
         void set_priority(uint64_t p) { _priority = p; }
 
+        // sound state: everything which plays out from note on
+        template<class Archive>
+        void serialize(Archive &a) {
+            _algo.serialize(a);
+            _lfo.serialize(a);
+            a(_lfo_output);
+            _pitch_env.serialize(a);
+            a(_pitch);
+            _freq_eg.serialize(a);
+        }
+
+        // the whole voice as it renders live, for engine snapshots.
+        // the engine rebinds the part's patch after reading.
+        void snapshot(state_writer &a) {
+            leave();
+            state(a);
+        }
+        void restore(state_reader &a) {
+            leave(false);
+            state(a);
+            set_part(std::min(std::max(_part_index, 0), max_parts - 1));
+        }
+
     private:
         int highest_key() const;
+        int key_pitch(int key) const;
+        void render(int *output, int *side);
+
+        template<class Archive>
+        void state(Archive &a) {
+            serialize(a);
+            a(_part_index);
+            a(_counter);
+            a(_key);
+            a(_velocity);
+            a(_keys);
+            a(_output);
+            if (_algo.copies() > 1) {
+                a(_side);
+            }
+            a(_pressure);
+            a(_pressure_in);
+            a(_priority);
+        }
+
+        // note cache
+        static bool deterministic(patch const *);
+        note_inputs inputs() const { return { _part->mod_wheel, _part->pitch_bend, _pressure }; }
+        void settle();
+        void cache();
+        void play();
+        void record();
+        void resume();
+        void leave(bool live = true);
 
     private:
         algo _algo;
         lfo _lfo;
         int _lfo_output;
         globals const *_globals;
+        part const *_part;
+        int _part_index;
         patch const *_patch;
         envelope _pitch_env;
         int _pitch;
@@ -53,10 +137,18 @@ class voice {
         int _velocity;
         uint64_t _keys[2];
         int _output[16];
-        voice_status _status;
+        int _side[16];
         int _pressure; // smoothed value to use
         int _pressure_in; // current value
         uint64_t _priority;
+
+        note_cache *_cache;
+        uint64_t _patch_hash;
+        note_entry *_play; // playing back from
+        note_entry *_rec; // recording into
+        int _group; // groups played or recorded since note on
+        bool _deterministic; // the patch plays the same from the same state
+        std::vector<uint8_t> _state;
 };
 
 #endif /* voice_hpp */
@@ -0,0 +1,118 @@
+//
+//  wav.cpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#include "wav.hpp"
+
+#include <algorithm>
+
+static int const header_size = 44;
+static int const frame_size = 3;
+
+static void
+put16(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void
+put32(uint8_t *p, uint32_t v) {
+    put16(p, v);
+    put16(p + 2, v >> 16);
+}
+
+static void
+header(uint8_t *h, int sampleRate, uint32_t frames) {
+    uint32_t const data = frames * frame_size;
+
+    std::copy_n("RIFF", 4, h);
+    put32(h + 4, 36 + data);
+    std::copy_n("WAVEfmt ", 8, h + 8);
+    put32(h + 16, 16);                              // fmt chunk size
+    put16(h + 20, 1);                               // PCM
+    put16(h + 22, 1);                               // mono
+    put32(h + 24, (uint32_t)sampleRate);
+    put32(h + 28, (uint32_t)sampleRate * frame_size);
+    put16(h + 32, frame_size);
+    put16(h + 34, frame_size * 8);
+    std::copy_n("data", 4, h + 36);
+    put32(h + 40, data);
+}
+
+wav_writer::wav_writer() {
+    _file = nullptr;
+    _rate = 0;
+    _frames = 0;
+    _error = false;
+}
+
+wav_writer::~wav_writer() {
+    close();
+}
+
+bool
+wav_writer::open(char const *path, int sampleRate) {
+    close();
+
+    _file = std::fopen(path, "wb");
+    if (_file == nullptr) {
+        return false;
+    }
+    _rate = sampleRate;
+    _frames = 0;
+    _error = false;
+
+    // sizes are zero until close
+    uint8_t h[header_size];
+    header(h, sampleRate, 0);
+    _error = std::fwrite(h, header_size, 1, _file) != 1;
+    return !_error;
+}
+
+bool
+wav_writer::write(int const *samples, int count) {
+    if (_file == nullptr) {
+        return false;
+    }
+
+    uint8_t buffer[64 * frame_size];
+    for (int done = 0; done < count; ) {
+        int const n = std::min(count - done, 64);
+        for (int i = 0; i < n; ++i) {
+            int const s = std::max(-0x800000, std::min(samples[done + i] >> 4, 0x7fffff));
+            uint8_t *p = buffer + i * frame_size;
+            p[0] = (uint8_t)s;
+            p[1] = (uint8_t)(s >> 8);
+            p[2] = (uint8_t)(s >> 16);
+        }
+        if (std::fwrite(buffer, frame_size, n, _file) != (size_t)n) {
+            _error = true;
+        }
+        done += n;
+    }
+    _frames += (uint32_t)count;
+    return !_error;
+}
+
+bool
+wav_writer::close() {
+    if (_file == nullptr) {
+        return !_error;
+    }
+
+    uint8_t h[header_size];
+    header(h, _rate, _frames);
+    if (std::fseek(_file, 0, SEEK_SET) != 0 || std::fwrite(h, header_size, 1, _file) != 1) {
+        _error = true;
+    }
+
+    if (std::fclose(_file) != 0) {
+        _error = true;
+    }
+    _file = nullptr;
+    return !_error;
+}
@@ -0,0 +1,36 @@
+//
+//  wav.hpp
+//  purefm
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+#ifndef wav_hpp
+#define wav_hpp
+
+#include <cstdint>
+#include <cstdio>
+
+// streams engine output to a mono 24 bit PCM wave file. the header sizes
+// are filled in by close().
+class wav_writer {
+    public:
+        wav_writer();
+        virtual ~wav_writer();
+
+        bool open(char const *path, int sampleRate);
+
+        // engine output, full scale at 1 << 27 as the kernel treats it
+        bool write(int const *samples, int count);
+
+        bool close();
+
+    private:
+        FILE *_file;
+        int _rate;
+        uint32_t _frames;
+        bool _error;
+};
+
+#endif /* wav_hpp */
@@ -18,7 +18,6 @@ NS_ASSUME_NONNULL_BEGIN
 
 @interface Envelope : NSObject< NSCoding >
 
-@property (nonatomic) struct eg_status const *status;
 @property (nonatomic,readonly) NSArray< EnvelopeStage * > *stages;
 @property (nonatomic) NSUInteger keyUp;
 @property (nonatomic) BOOL loop;
@@ -42,7 +41,7 @@ NS_ASSUME_NONNULL_BEGIN
 - (env_patch_ptr::pointer const &)patch;
 #endif // __cplusplus
 
-- (void)updateStatus;
+- (void)updateStatus:(struct eg_status const *)status;
 
 - (void)addStagesObject:(EnvelopeStage *)object;
 - (void)replaceObjectInStagesAtIndex:(NSUInteger)index withObject:(id)object;
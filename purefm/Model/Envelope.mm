@@ -16,12 +16,10 @@
 @implementation Envelope {
     NSMutableArray< EnvelopeStage * > *_stages;
     env_patch_ptr::pointer _patch;
-    struct eg_status const *_status;
     int _playingStage;
     int _output;
 }
 
-@synthesize status = _status;
 @synthesize playingStage = _playingStage;
 @synthesize output = _output;
 
@@ -157,18 +155,16 @@
 
 // MARK: status
 
-- (void)updateStatus {
-    if (_status != NULL) {
-        if (_status->stage != _playingStage) {
-            [self willChangeValueForKey:@"playingStage"];
-            _playingStage = _status->stage;
-            [self didChangeValueForKey:@"playingStage"];
-        }
-        if (_status->output != _output) {
-            [self willChangeValueForKey:@"output"];
-            _output = _status->output;
-            [self didChangeValueForKey:@"output"];
-        }
+- (void)updateStatus:(struct eg_status const *)status {
+    if (status->stage != _playingStage) {
+        [self willChangeValueForKey:@"playingStage"];
+        _playingStage = status->stage;
+        [self didChangeValueForKey:@"playingStage"];
+    }
+    if (status->output != _output) {
+        [self willChangeValueForKey:@"output"];
+        _output = status->output;
+        [self didChangeValueForKey:@"output"];
     }
 }
 
@@ -34,6 +34,8 @@ typedef enum {
 
     // operator items:
     // value types
+    // also uses kFeedback, only when the op has its own, and
+    // kWave, only when not a sine
     kSum,
     kMod,
     kEnabled,
@@ -237,6 +239,9 @@ midiToInt7(uint8_t value) {
     Operator *op = state.operators[num-1];
     int16_t s16;
 
+    op.feedback = -1;
+    op.wave = kOpWave_Sine;
+
     while (*length > 0) {
         uint8_t pair[2];
         if (!consume(bytes, length, pair, 1)) {
@@ -323,6 +328,14 @@ midiToInt7(uint8_t value) {
                 op.fixed = pair[1];
                 break;
 
+            case kFeedback:
+                op.feedback = pair[1];
+                break;
+
+            case kWave:
+                op.wave = pair[1];
+                break;
+
             default:
                 return NO;
             }
@@ -598,6 +611,18 @@ midiToInt7(uint8_t value) {
     pair[1] = op.fixed;
     [data appendBytes:pair length:2];
 
+    if (op.feedback >= 0) {
+        pair[0] = kFeedback;
+        pair[1] = op.feedback;
+        [data appendBytes:pair length:2];
+    }
+
+    if (op.wave != kOpWave_Sine) {
+        pair[0] = kWave;
+        pair[1] = op.wave;
+        [data appendBytes:pair length:2];
+    }
+
     [data appendData:[self serializeFrequency:op.frequency forType:kFrequency]];
     [data appendData:[self serializeFrequency:op.detune forType:kDetune]];
     [data appendData:[self serializeEnvelope:op.envelope]];
@@ -458,6 +458,8 @@ dx7_curve(int value) {
         op.keyScaleRight = dx7_scale(dx7_op->right);
         op.scaleTypeLeft = dx7_curve(dx7_op->left_curve);
         op.scaleTypeRight = dx7_curve(dx7_op->right_curve);
+        op.feedback = -1;
+        op.wave = kOpWave_Sine;
 
         double v;
         if (dx7_op->osc_mode != 0) {
@@ -481,9 +483,13 @@ dx7_curve(int value) {
     state.operators[6].enabled = NO;
     state.operators[6].sum = 7;
     state.operators[6].mod = -1;
+    state.operators[6].feedback = -1;
+    state.operators[6].wave = kOpWave_Sine;
     state.operators[7].enabled = NO;
     state.operators[7].sum = -1;
     state.operators[7].mod = -1;
+    state.operators[7].feedback = -1;
+    state.operators[7].wave = kOpWave_Sine;
 
     Envelope *e = [[Envelope alloc] init];
     for (i = 0; i < 4; ++i) {
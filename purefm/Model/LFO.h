@@ -33,9 +33,8 @@ NS_ASSUME_NONNULL_BEGIN
 #endif // __cplusplus
 
 - (void)setParameter:(AUParameter *)parameter value:(AUValue)value;
-- (void)updateStatus;
+- (void)updateStatus:(struct eg_status const *)status;
 
-@property (nonatomic) struct eg_status const *status;
 @property (nonatomic) AUParameterTree *parameterTree;
 
 @property (nonatomic,readonly) Envelope *envelope;
@@ -21,11 +21,9 @@
     LFOWave _wave;
     lfo_patch_ptr::pointer _patch;
     AUParameterTree *_parameterTree;
-    struct eg_status const *_status;
 }
 
 @synthesize parameterTree = _parameterTree;
-@synthesize status = _status;
 
 // MARK: init / coder
 
@@ -76,10 +74,9 @@
 
 // MARK: status
 
-- (void)updateStatus {
-    if (_status != NULL && _envelope != nil) {
-        _envelope.status = _status;
-        [_envelope updateStatus];
+- (void)updateStatus:(struct eg_status const *)status {
+    if (_envelope != nil) {
+        [_envelope updateStatus:status];
     }
 }
 
@@ -131,7 +128,7 @@
 
 - (void)setWave:(LFOWave)wave {
     [self updateWave:wave];
-    [[_parameterTree parameterWithAddress:kParam_LFOWave] setValue:(AUValue)_wave];
+    [purefmAudioUnit setModelValue:(AUValue)_wave forParameter:[_parameterTree parameterWithAddress:kParam_LFOWave]];
 }
 - (LFOWave)wave {
     return _wave;
@@ -146,7 +143,7 @@
 
 - (void)setFrequency:(int)frequency {
     _patch->frequency = frequency;
-    [[_parameterTree parameterWithAddress:kParam_LFOFreq] setValue:(AUValue)frequency];
+    [purefmAudioUnit setModelValue:(AUValue)frequency forParameter:[_parameterTree parameterWithAddress:kParam_LFOFreq]];
 }
 - (int)frequency {
     return _patch->frequency;
@@ -7,6 +7,7 @@
 //
 
 #import <Foundation/Foundation.h>
+#import <AudioUnit/AudioUnit.h>
 #import "Envelope.h"
 #import "status.h"
 
@@ -21,6 +22,18 @@ typedef enum {
     kScale_ExpUp      = 0x03
 } ScaleType;
 
+// as op_wave
+typedef enum {
+    kOpWave_Sine = 0,
+    kOpWave_HalfSine,
+    kOpWave_AbsSine,
+    kOpWave_PulseSine,
+    kOpWave_AltSine,
+    kOpWave_CamelSine,
+    kOpWave_Square,
+    kOpWave_LogSaw,
+} OpWave;
+
 NS_ASSUME_NONNULL_BEGIN
 
 @interface Operator : NSObject< NSCoding >
@@ -34,7 +47,7 @@ NS_ASSUME_NONNULL_BEGIN
 - (op_ptr const &)patch;
 #endif // __cplusplus
 
-@property (nonatomic) struct eg_status const *status;
+@property (nonatomic) AUParameterTree *parameterTree;
 
 @property (nonatomic,readonly) int number;
 @property (nonatomic,readonly) Envelope *envelope;
@@ -55,8 +68,11 @@ NS_ASSUME_NONNULL_BEGIN
 @property (nonatomic) int frequency;
 @property (nonatomic) int detune;
 @property (nonatomic) BOOL fixed;
+@property (nonatomic) int feedback;     // when fed back, or -1 for the patch's
+@property (nonatomic) OpWave wave;
 
-- (void)updateStatus;
+- (void)setParameter:(AUParameter *)parameter value:(AUValue)value;
+- (void)updateStatus:(struct eg_status const *)status;
 
 @end
 
@@ -8,6 +8,7 @@
 
 #import "Operator.h"
 #import "Envelope.h"
+#import "purefmAudioUnit.h"
 #import "tables.hpp"
 #import "globals.hpp"
 
@@ -21,10 +22,10 @@
     int _detune;
 
     op_ptr _patch;
-    struct eg_status const *_status;
+    AUParameterTree *_parameterTree;
 }
 
-@synthesize status = _status;
+@synthesize parameterTree = _parameterTree;
 
 // MARK: init / coder
 
@@ -46,6 +47,8 @@
     [coder encodeInt:self.frequency forKey:@"frequency"];
     [coder encodeInt:self.detune forKey:@"detune"];
     [coder encodeBool:self.fixed forKey:@"fixed"];
+    [coder encodeInt:self.feedback forKey:@"feedback"];
+    [coder encodeInt:self.wave forKey:@"wave"];
 }
 
 - (id)initWithCoder:(NSCoder *)coder {
@@ -72,6 +75,12 @@
     self.frequency = [coder decodeIntForKey:@"frequency"];
     self.detune = [coder decodeIntForKey:@"detune"];
     self.fixed = [coder decodeBoolForKey:@"fixed"];
+    if ([coder containsValueForKey:@"feedback"]) {
+        self.feedback = [coder decodeIntForKey:@"feedback"];
+    } else {
+        self.feedback = -1;
+    }
+    self.wave = (OpWave)[coder decodeIntForKey:@"wave"];
 
     return self;
 }
@@ -92,6 +101,8 @@
     o.level = 0;
     o.velocity = 0;
     o.frequency = 0;
+    o.feedback = -1;
+    o.wave = kOpWave_Sine;
 
     return o;
 }
@@ -102,18 +113,35 @@
     return _patch;
 }
 
-// MARK: status
+// MARK: AUParameters
 
-- (void)updateStatus {
-    if (_envelope != nil) {
-        [_envelope updateStatus];
+- (void)setParameterTree:(AUParameterTree *)parameterTree {
+    _parameterTree = parameterTree;
+
+    // refresh current values into parameter tree
+    [self setLevel:self.level];
+}
+
+- (void)didChange:(NSString *)key {
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self willChangeValueForKey:key];
+        [self didChangeValueForKey:key];
+    });
+}
+
+- (void)setParameter:(AUParameter *)parameter value:(AUValue)value {
+    if (parameter.address == kParam_OpLevel + _number - 1) {
+        _level = (int)value;
+        _patch->level = tables::level_param(_level);
+        [self didChange:@"level"];
     }
 }
 
-- (void)setStatus:(const struct eg_status *)status {
-    _status = status;
+// MARK: status
+
+- (void)updateStatus:(struct eg_status const *)status {
     if (_envelope != nil) {
-        _envelope.status = status;
+        [_envelope updateStatus:status];
     }
 }
 
@@ -155,6 +183,7 @@
 - (void)setLevel:(int)level {
     _level = level;
     _patch->level = tables::level_param(level);
+    [purefmAudioUnit setModelValue:(AUValue)level forParameter:[_parameterTree parameterWithAddress:kParam_OpLevel + _number - 1]];
 }
 - (int)level {
     return _level;
@@ -239,6 +268,27 @@
     return (BOOL)(_patch->fixed);
 }
 
+- (void)setFeedback:(int)feedback {
+    if (feedback > 127 || feedback < 0) {
+        _patch->feedback = -1;
+    } else {
+        _patch->feedback = feedback;
+    }
+}
+- (int)feedback {
+    return _patch->feedback;
+}
+
+- (void)setWave:(OpWave)wave {
+    if (wave < kOpWave_Sine || wave > kOpWave_LogSaw) {
+        wave = kOpWave_Sine;
+    }
+    _patch->wave = (int)wave;
+}
+- (OpWave)wave {
+    return (OpWave)(_patch->wave);
+}
+
 + (void)clampMIDIValue:(id *)ioValue {
     int v = [*ioValue intValue];
     if (v < 0) {
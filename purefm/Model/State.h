@@ -24,7 +24,6 @@ NS_ASSUME_NONNULL_BEGIN
 @property NSString *name;
 
 @property (nonatomic) AUParameterTree *parameterTree;
-@property (nonatomic) struct status const *status;
 
 @property (nonatomic,readonly) NSArray< Operator * > *operators;
 @property (nonatomic,readonly) Envelope *pitchEnvelope;
@@ -38,12 +37,19 @@ NS_ASSUME_NONNULL_BEGIN
 @property (nonatomic) int expr1;
 @property (nonatomic) int expr2;
 
+// unison: copies of each note [1,4], their detune from lowest to highest in
+// pitch units, and the pan of the outer copies [0,128]
+@property (nonatomic) int unison;
+@property (nonatomic) int spread;
+@property (nonatomic) int width;
+
 #ifdef __cplusplus
 - (patch_ptr::pointer const &)patch;
 #endif // __cplusplus
 
 - (void)setParameter:(AUParameter *)parameter value:(AUValue)value;
-- (void)updateStatus;
+// a status read back from the kernel
+- (void)updateStatus:(struct status const *)status;
 
 @end
 
@@ -10,6 +10,7 @@
 #import "purefmAudioUnit.h"
 #import "globals.hpp"
 
+#include <algorithm>
 #include <memory>
 
 @implementation State {
@@ -20,6 +21,8 @@
 
     patch_ptr::pointer _patch;
     AUParameterTree *_parameterTree;
+    struct status _status;
+    BOOL _hasStatus;
 }
 
 @synthesize parameterTree = _parameterTree;
@@ -40,6 +43,9 @@
     self.tuning = 0;
     self.expr1 = 1;  // modulation wheel
     self.expr2 = 11; // expression control
+    self.unison = 1;
+    self.spread = 0;
+    self.width = 0;
 
     return self;
 }
@@ -58,6 +64,9 @@
     [coder encodeInt:self.tuning forKey:@"tuning"];
     [coder encodeInt:self.expr1 forKey:@"expr1"];
     [coder encodeInt:self.expr2 forKey:@"expr2"];
+    [coder encodeInt:self.unison forKey:@"unison"];
+    [coder encodeInt:self.spread forKey:@"spread"];
+    [coder encodeInt:self.width forKey:@"width"];
 }
 
 - (id)initWithCoder:(NSCoder *)coder {
@@ -79,6 +88,10 @@
     self.tuning = [coder decodeIntForKey:@"tuning"];
     self.expr1 = [coder decodeIntForKey:@"expr1"];
     self.expr2 = [coder decodeIntForKey:@"expr2"];
+    // absent from older presets, which decode as a single copy
+    self.unison = [coder decodeIntForKey:@"unison"];
+    self.spread = [coder decodeIntForKey:@"spread"];
+    self.width = [coder decodeIntForKey:@"width"];
 
     return self;
 }
@@ -103,28 +116,29 @@
 
 // MARK: status
 
+- (void)updateStatus:(struct status const *)status {
+    _status = *status;
+    _hasStatus = YES;
+    [self updateStatus];
+}
+
+// pass the last status down, also to parts created since
 - (void)updateStatus {
     struct voice_status const *s;
-    if (_status == NULL) {
-        return;
-    }
-    s = _status->voice;
-    if (s == NULL) {
+    if (!_hasStatus) {
         return;
     }
+    s = &_status.voice;
     if (_lfo != nil) {
-        _lfo.status = s->lfo;
-        [_lfo updateStatus];
+        [_lfo updateStatus:&s->lfo];
     }
     if (_pitchEnvelope != nil) {
-        _pitchEnvelope.status = s->pitch;
-        [_pitchEnvelope updateStatus];
+        [_pitchEnvelope updateStatus:&s->pitch];
     }
     if (_operators != nil) {
         int i;
         for (i = 0; i < 8; i++) {
-            _operators[i].status = s->ops[i];
-            [_operators[i] updateStatus];
+            [_operators[i] updateStatus:&s->ops[i]];
         }
     }
 }
@@ -134,6 +148,9 @@
 - (void)setParameterTree:(AUParameterTree *)parameterTree {
     _parameterTree = parameterTree;
     self.lfo.parameterTree = parameterTree;
+    for (Operator *op in self.operators) {
+        op.parameterTree = parameterTree;
+    }
 
     // refersh current values into parameter tree
     [self setFeedback:self.feedback];
@@ -180,6 +197,13 @@
             [self.lfo setParameter:parameter value:value];
             break;
 
+        default:
+            if (parameter.address >= kParam_OpLevel && parameter.address < kParam_OpLevel + 8) {
+                [self.operators[parameter.address - kParam_OpLevel] setParameter:parameter value:value];
+            }
+            // operator rates are the kernel's alone
+            break;
+
     }
 }
 
@@ -187,7 +211,7 @@
 
 - (void)setFeedback:(int)feedback {
     _patch->feedback = feedback;
-    [[_parameterTree parameterWithAddress:kParam_Feedback] setValue:(AUValue)feedback];
+    [purefmAudioUnit setModelValue:(AUValue)feedback forParameter:[_parameterTree parameterWithAddress:kParam_Feedback]];
 }
 - (int)feedback {
     return _patch->feedback;
@@ -195,7 +219,7 @@
 
 - (void)setMono:(BOOL)mono {
     _patch->mono = (bool)mono;
-    [[_parameterTree parameterWithAddress:kParam_Mono] setValue:(AUValue)mono];
+    [purefmAudioUnit setModelValue:(AUValue)mono forParameter:[_parameterTree parameterWithAddress:kParam_Mono]];
 }
 - (BOOL)mono {
     return (BOOL)(_patch->mono);
@@ -203,7 +227,7 @@
 
 - (void)setMiddleC:(int)middleC {
     _patch->middle_c = middleC;
-    [[_parameterTree parameterWithAddress:kParam_MiddleC] setValue:(AUValue)middleC];
+    [purefmAudioUnit setModelValue:(AUValue)middleC forParameter:[_parameterTree parameterWithAddress:kParam_MiddleC]];
 }
 - (int)middleC {
     return _patch->middle_c;
@@ -211,7 +235,7 @@
 
 - (void)setPortamento:(int)portamento {
     [self updatePortamento:portamento];
-    [[_parameterTree parameterWithAddress:kParam_Portamento] setValue:(AUValue)portamento];
+    [purefmAudioUnit setModelValue:(AUValue)portamento forParameter:[_parameterTree parameterWithAddress:kParam_Portamento]];
 }
 - (int)portamento {
     return _portamento;
@@ -219,7 +243,7 @@
 
 - (void)setTuning:(int)tuning{
     _patch->tuning = tuning;
-    [[_parameterTree parameterWithAddress:kParam_Tuning] setValue:(AUValue)tuning];
+    [purefmAudioUnit setModelValue:(AUValue)tuning forParameter:[_parameterTree parameterWithAddress:kParam_Tuning]];
 }
 - (int)tuning {
     return _patch->tuning;
@@ -239,6 +263,27 @@
     return _patch->expr2;
 }
 
+- (void)setUnison:(int)unison {
+    _patch->unison = std::min(std::max(unison, 1), max_unison);
+}
+- (int)unison {
+    return _patch->unison;
+}
+
+- (void)setSpread:(int)spread {
+    _patch->spread = spread;
+}
+- (int)spread {
+    return _patch->spread;
+}
+
+- (void)setWidth:(int)width {
+    _patch->width = std::min(std::max(width, 0), 128);
+}
+- (int)width {
+    return _patch->width;
+}
+
 - (NSArray< Operator * > *)operators {
     if (_operators == nil) {
         _operators = @[
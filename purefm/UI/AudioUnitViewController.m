@@ -53,6 +53,9 @@
         if ([self isViewLoaded]) {
             [self connectView];
         }
+        if (_refresh != nil) {
+            [unit setStatusEnabled:YES];
+        }
     });
 }
 
@@ -65,14 +68,16 @@
 - (void)viewWillDisappear {
     [_refresh invalidate];
     _refresh = nil;
+    [_audioUnit setStatusEnabled:NO];
     [super viewWillDisappear];
 }
 
 - (void)viewWillAppear {
+    [_audioUnit setStatusEnabled:YES];
     _refresh = [NSTimer scheduledTimerWithTimeInterval:0.100
                                                repeats:YES
                                                block:^(NSTimer * _Nonnull timer) {
-        [self.state updateStatus];
+        [self.audioUnit updateStatus];
     }];
 
     [super viewWillAppear];
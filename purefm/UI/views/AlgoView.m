@@ -15,7 +15,7 @@
     OperatorView *operatorViews[8];     // operators
     OperatorView *phaseViews[8];        // phase targets
     OperatorView *sumViews[8];          // sum targets
-    Operator *_feedback;                // feedback input op, if any
+    Operator *_feedback;                // an op modulated by feedback, if any
 
     // properties
     NSIndexSet *_selectionIndexes;              // current selection
@@ -41,21 +41,31 @@
 
 - (void)setOperators:(NSArray<Operator *> *)operators {
     _operators = operators;
-    self.feedback = nil;
 
     NSAssert([operators count] == 8, @"count is %lu, not 8", [operators count]);
 
+    int n;
+    for (n = 0; n < 8; ++n) {
+        operatorViews[n].hidden = NO;
+    }
+    [self findFeedback];
+
+    self.needsDisplay = YES;
+}
+
+// any number of ops may be in feedback loops, each its own
+- (void)findFeedback {
+    Operator *feedback = nil;
+
     int n;
     for (n = 0; n < 8; ++n) {
         int mod = _operators[n].mod;
 
         if (mod >= 0 && mod <= n) {
-            self.feedback = _operators[n];
+            feedback = _operators[n];
         }
-        operatorViews[n].hidden = NO;
     }
-
-    self.needsDisplay = YES;
+    self.feedback = feedback;
 }
 
 - (void)awakeFromNib {
@@ -169,17 +179,9 @@
     if (operator.mod == op) {
         operator.mod = -1;
     } else {
-        // mark new feedback
-        if (op <= mod) {
-            if (_feedback != nil) {
-                _feedback.mod = -1;
-            }
-            self.feedback = operator;
-        }
-
-        // and hook it up
         operator.mod = op;
     }
+    [self findFeedback];
     self.needsDisplay = YES;
 }
 
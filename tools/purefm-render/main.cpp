@@ -0,0 +1,258 @@
+//
+//  main.cpp
+//  purefm-render
+//
+//  Created by Paul Forgey on 10/19/26.
+//  Copyright © 2026 Paul Forgey. All rights reserved.
+//
+
+// renders a list of jobs, one per line, tab separated:
+//
+//   patch  midi file  seconds  output wave file
+//
+// where patch is bank.syx:n (0 based voice) or library:name.
+// seconds of 0 renders the midi file plus a release tail.
+// with -s, each job in turn is split at its silences across the threads.
+// -t retunes every patch to a scala scale, laid out by the -k keyboard
+// mapping if given.
+// -e estimates what each job's patch costs to play instead of rendering.
+// built with PUREFM_TRACE, -T writes the render's trace points to a chrome
+// trace / perfetto json file.
+
+#include "cost.hpp"
+#include "dx7.hpp"
+#include "farm.hpp"
+#include "intern.hpp"
+#include "library.hpp"
+#include "scala.hpp"
+#include "trace.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef PUREFM_TRACE
+static char const trace_usage[] = " [-T trace.json]";
+static int const trace_records = 1 << 16; // per thread
+#else
+static char const trace_usage[] = "";
+#endif
+
+static void
+usage() {
+    std::fprintf(stderr, "usage: purefm-render [-r rate] [-j threads] [-c cache MB] [-s] [-e] [-t scale.scl [-k map.kbm]]%s jobs.txt\n",
+                 trace_usage);
+    std::exit(2);
+}
+
+// patch sources are opened once however many jobs use them. every patch is
+// retuned to keys if given, then interned, so jobs on the same patch share it
+// however they name it.
+class sources {
+    public:
+        sources(key_table_ptr const &keys) : _keys(keys) {}
+
+        patch_ptr::pointer find(std::string const &spec) {
+            size_t const colon = spec.rfind(':');
+            if (colon == std::string::npos) {
+                return nullptr;
+            }
+            std::string const file = spec.substr(0, colon);
+            std::string const which = spec.substr(colon + 1);
+
+            if (file.size() > 4 && file.compare(file.size() - 4, 4, ".syx") == 0) {
+                auto &bank = _banks[file];
+                if (bank.empty()) {
+                    if (dx7_load_file(file.c_str(), &bank) != dx7_ok) {
+                        return nullptr;
+                    }
+                    for (auto &voice : bank) {
+                        voice.patch = finish(voice.patch);
+                    }
+                }
+                size_t const n = (size_t)std::strtoul(which.c_str(), nullptr, 10);
+                return n < bank.size() ? bank[n].patch : nullptr;
+            }
+
+            auto &lib = _libraries[file];
+            if (lib == nullptr) {
+                lib.reset(new library());
+                if (!lib->open(file.c_str())) {
+                    return nullptr;
+                }
+            }
+            return finish(lib->load(lib->find(which)));
+        }
+
+    private:
+        patch_ptr::pointer finish(patch_ptr::pointer const &patch) {
+            if (patch != nullptr && _keys != nullptr) {
+                patch->keys = _keys;
+            }
+            return intern_patch(patch);
+        }
+
+        key_table_ptr _keys;
+        std::map< std::string, std::vector<dx7_voice> > _banks;
+        std::map< std::string, std::unique_ptr<library> > _libraries;
+};
+
+int
+main(int argc, char **argv) {
+    double rate = 48000.0;
+    int threads = 0;
+    size_t cache = 0;
+    bool split = false;
+    bool estimate = false;
+    char const *scl = nullptr;
+    char const *kbm = nullptr;
+#ifdef PUREFM_TRACE
+    char const *trace_path = nullptr;
+#endif
+
+    int i;
+    for (i = 1; i < argc && argv[i][0] == '-'; ++i) {
+        if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            rate = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            cache = (size_t)std::atoi(argv[++i]) << 20;
+        } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            scl = argv[++i];
+        } else if (std::strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            kbm = argv[++i];
+        } else if (std::strcmp(argv[i], "-s") == 0) {
+            split = true;
+        } else if (std::strcmp(argv[i], "-e") == 0) {
+            estimate = true;
+#ifdef PUREFM_TRACE
+        } else if (std::strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+#endif
+        } else {
+            usage();
+        }
+    }
+    if (i + 1 != argc || rate <= 0.0 || (kbm != nullptr && scl == nullptr)) {
+        usage();
+    }
+
+    key_table_ptr keys;
+    if (scl != nullptr) {
+        scala_scale scale;
+        if (scala_load_scale(scl, &scale) != scala_ok) {
+            std::fprintf(stderr, "%s: not a scala scale\n", scl);
+            return 1;
+        }
+        scala_map map = scala_default_map(scale);
+        if (kbm != nullptr && scala_load_map(kbm, &map) != scala_ok) {
+            std::fprintf(stderr, "%s: not a scala keyboard mapping\n", kbm);
+            return 1;
+        }
+        keys = scala_compile(scale, map);
+        if (keys == nullptr) {
+            std::fprintf(stderr, "%s: the reference key is unmapped\n", kbm);
+            return 1;
+        }
+    }
+
+    std::ifstream in(argv[i]);
+    if (!in) {
+        std::perror(argv[i]);
+        return 1;
+    }
+
+    sources src(keys);
+    std::vector<render_job> jobs;
+    std::string line;
+    for (int n = 1; std::getline(in, line); ++n) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string spec, midi, seconds, output;
+        std::getline(fields, spec, '\t');
+        std::getline(fields, midi, '\t');
+        std::getline(fields, seconds, '\t');
+        std::getline(fields, output, '\t');
+        if (output.empty()) {
+            std::fprintf(stderr, "%s:%d: expected 4 tab separated fields\n", argv[i], n);
+            return 1;
+        }
+
+        render_job job;
+        job.patch = src.find(spec);
+        if (job.patch == nullptr) {
+            std::fprintf(stderr, "%s:%d: no patch %s\n", argv[i], n, spec.c_str());
+            return 1;
+        }
+        job.midi = midi;
+        job.length = std::atof(seconds.c_str());
+        job.output = output;
+        jobs.push_back(job);
+    }
+
+    if (estimate) {
+        for (auto const &job : jobs) {
+            patch_cost const c = estimate_cost(job.patch.get(), rate);
+            std::printf("%s: %d ops, %d passing, %d loops%s, ",
+                        job.output.c_str(), c.ops, c.passes, c.loops, c.lfo ? ", voice lfo" : "");
+            if (c.copies > 1) {
+                std::printf("%d unison copies, ", c.copies);
+            }
+            std::printf("%.0f cycles per voice sample, ", c.cycles);
+            if (c.endless) {
+                std::printf("sounds until stolen");
+            } else {
+                std::printf("%.2fs release", c.release);
+            }
+            std::printf(", %d voices\n", c.voices);
+        }
+        return 0;
+    }
+
+    auto const start = std::chrono::steady_clock::now();
+    render_farm farm(rate, threads, cache);
+#ifdef PUREFM_TRACE
+    if (trace_path != nullptr) {
+        // the calling thread renders too, and each split job starts its own
+        int const traced = farm.threads() * (split ? (int)jobs.size() : 1) + 1;
+        trace::init(traced, trace_records);
+    }
+#endif
+    std::vector<bool> results;
+    if (split) {
+        for (auto const &job : jobs) {
+            split_stats stats;
+            results.push_back(farm.run_split(job, &stats));
+            std::fprintf(stderr, "%s: %d chunks, %d matched, %d rendered again\n",
+                         job.output.c_str(), stats.chunks, stats.matched, stats.rendered);
+        }
+    } else {
+        results = farm.run(jobs);
+    }
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+#ifdef PUREFM_TRACE
+    if (trace_path != nullptr && !trace::write_json(trace_path)) {
+        std::perror(trace_path);
+    }
+#endif
+
+    int failed = 0;
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        if (!results[j]) {
+            std::fprintf(stderr, "failed: %s\n", jobs[j].output.c_str());
+            failed++;
+        }
+    }
+    std::fprintf(stderr, "%zu jobs in %.2fs\n", jobs.size(), elapsed.count());
+    return failed == 0 ? 0 : 1;
+}